@@ -0,0 +1,93 @@
+// Micro-benchmark: ThreadSafeQueue vs MpmcQueue under 1 to 32 producer and
+// consumer threads. Items are move-only-friendly structs shaped like
+// FramePayload (a few scalars plus a heap vector), passed by move.
+//
+//   queue_bench [items_per_run] [capacity]
+
+#include "MpmcQueue.h"
+#include "ThreadSafeQueue.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Item {
+  int64_t pts = 0;
+  int64_t seq = 0;
+  bool isValid = true;
+  std::vector<int> redactions;
+};
+
+template <typename Queue>
+static double run(int producers, int consumers, int64_t items,
+                  size_t capacity) {
+  Queue queue(capacity);
+  std::vector<std::thread> threads;
+  std::vector<int64_t> consumed(consumers, 0);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&, c]() {
+      while (auto item = queue.pop())
+        consumed[c] += item->seq >= 0;
+    });
+  }
+  std::vector<std::thread> producerThreads;
+  for (int p = 0; p < producers; ++p) {
+    producerThreads.emplace_back([&, p]() {
+      for (int64_t i = p; i < items; i += producers) {
+        Item item;
+        item.seq = i;
+        queue.push(std::move(item));
+      }
+    });
+  }
+  for (auto &t : producerThreads)
+    t.join();
+  queue.close();
+  for (auto &t : threads)
+    t.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - t0)
+                       .count();
+
+  int64_t total = 0;
+  for (int64_t n : consumed)
+    total += n;
+  if (total != items) {
+    std::cerr << "lost items: " << total << " of " << items << std::endl;
+    std::exit(1);
+  }
+  return items / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  int64_t items = argc > 1 ? std::stoll(argv[1]) : 1000000;
+  size_t capacity = argc > 2 ? std::stoul(argv[2]) : 50;
+
+  std::cout << "items=" << items << " capacity=" << capacity
+            << " (Mitems/s)\n";
+  std::cout << std::setw(8) << "threads" << std::setw(14) << "shape"
+            << std::setw(16) << "ThreadSafeQueue" << std::setw(12)
+            << "MpmcQueue" << "\n";
+  for (int threads = 1; threads <= 32; threads *= 2) {
+    // 1 producer / N consumers mirrors decodeQueue; N / N is the worst case.
+    for (int producers : {1, threads}) {
+      double locked =
+          run<ThreadSafeQueue<Item>>(producers, threads, items, capacity);
+      double ring = run<MpmcQueue<Item>>(producers, threads, items, capacity);
+      std::cout << std::setw(8) << threads << std::setw(14)
+                << (std::to_string(producers) + "p/" +
+                    std::to_string(threads) + "c")
+                << std::setw(16) << std::fixed << std::setprecision(2)
+                << locked << std::setw(12) << ring << "\n";
+      if (threads == 1)
+        break;
+    }
+  }
+  return 0;
+}
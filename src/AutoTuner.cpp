@@ -0,0 +1,180 @@
+#include "AutoTuner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// 64-bit FNV-1a over the file contents; good enough to notice a changed
+// model, and needs no extra dependency.
+static std::string hashFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  uint64_t hash = 1469598103934665603ULL;
+  std::vector<char> buf(1 << 16);
+  while (file) {
+    file.read(buf.data(), buf.size());
+    for (std::streamsize i = 0; i < file.gcount(); ++i) {
+      hash ^= static_cast<uint8_t>(buf[i]);
+      hash *= 1099511628211ULL;
+    }
+  }
+  std::ostringstream out;
+  out << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return out.str();
+}
+
+static std::string cpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.rfind("model name", 0) == 0) {
+      size_t colon = line.find(':');
+      if (colon != std::string::npos)
+        return line.substr(line.find_first_not_of(" \t", colon + 1));
+    }
+  }
+  return "unknown";
+}
+
+AutoTuner::AutoTuner(std::string cachePath, Objective objective)
+    : cachePath(std::move(cachePath)), objective(objective) {}
+
+AutoTuner::Objective AutoTuner::parseObjective(const std::string &name) {
+  return name == "latency" ? Objective::Latency : Objective::Throughput;
+}
+
+std::string AutoTuner::cacheKey(const std::string &modelPath,
+                                const std::string &engine,
+                                const std::string &settings) const {
+  std::string key =
+      hashFile(modelPath) + "|" + cpuModel() + "|" +
+      std::to_string(std::thread::hardware_concurrency()) + "|" + engine + "|" +
+      (objective == Objective::Latency ? "latency" : "throughput") + "|" +
+      settings;
+  // Tabs separate the cache fields, so keep them out of the key.
+  std::replace(key.begin(), key.end(), '\t', ' ');
+  return key;
+}
+
+// Cache lines: key<TAB>workers intraOpThreads batch fps latencyMs
+std::optional<TuneConfig> AutoTuner::lookup(const std::string &key) const {
+  std::ifstream file(cachePath);
+  std::string line;
+  std::optional<TuneConfig> found;
+  while (std::getline(file, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || line.compare(0, tab, key) != 0 ||
+        tab != key.size())
+      continue;
+    TuneConfig config;
+    std::istringstream fields(line.substr(tab + 1));
+    if (fields >> config.workers >> config.intraOpThreads >> config.batch >>
+        config.fps >> config.latencyMs)
+      found = config; // the last entry for a key wins
+  }
+  return found;
+}
+
+void AutoTuner::store(const std::string &key, const TuneConfig &config) const {
+  std::ofstream file(cachePath, std::ios::app);
+  if (!file) {
+    std::cerr << "Autotune: cannot write cache " << cachePath << std::endl;
+    return;
+  }
+  file << key << '\t' << config.workers << ' ' << config.intraOpThreads << ' '
+       << config.batch << ' ' << config.fps << ' ' << config.latencyMs << '\n';
+}
+
+bool AutoTuner::better(const TuneConfig &a, const TuneConfig &b) const {
+  if (objective == Objective::Latency)
+    return a.latencyMs / a.batch < b.latencyMs / b.batch;
+  return a.fps > b.fps;
+}
+
+std::vector<TuneConfig>
+AutoTuner::measure(const std::vector<RunFn> &sessions, int intraOpThreads,
+                   const std::vector<int> &batches) {
+  int maxWorkers = static_cast<int>(sessions.size());
+  std::vector<int> workerCounts = {maxWorkers};
+  if (maxWorkers > 1)
+    workerCounts.push_back(maxWorkers / 2);
+
+  std::vector<TuneConfig> results;
+  for (int batch : batches) {
+    for (int workers : workerCounts) {
+      std::mutex mtx;
+      double runTotalMs = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w]() {
+          double localMs = 0;
+          for (int r = 0; r < runsPerWorker; ++r) {
+            auto r0 = std::chrono::steady_clock::now();
+            sessions[w](batch);
+            localMs += std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - r0)
+                           .count();
+          }
+          std::lock_guard<std::mutex> lock(mtx);
+          runTotalMs += localMs;
+        });
+      }
+      for (auto &t : threads)
+        t.join();
+      double wallMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count();
+
+      TuneConfig config;
+      config.workers = workers;
+      config.intraOpThreads = intraOpThreads;
+      config.batch = batch;
+      config.fps = workers * runsPerWorker * batch * 1000.0 /
+                   std::max(1e-3, wallMs);
+      config.latencyMs = runTotalMs / (workers * runsPerWorker);
+      std::cout << "Autotune: workers=" << workers
+                << " intra=" << intraOpThreads << " batch=" << batch << " -> "
+                << config.fps << " fps, " << config.latencyMs << " ms/run"
+                << std::endl;
+      results.push_back(config);
+    }
+  }
+  return results;
+}
+
+TuneConfig AutoTuner::calibrate(const SessionFactory &factory,
+                                const std::vector<int> &batches,
+                                int maxWorkers, bool sweepIntraOp) {
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  int maxBatch = *std::max_element(batches.begin(), batches.end());
+  int maxIntra = sweepIntraOp ? cores : 1;
+
+  std::optional<TuneConfig> best;
+  for (int intra = 1; intra <= maxIntra; intra *= 2) {
+    int workers = std::max(1, std::min(maxWorkers, cores / intra));
+
+    // Sessions are expensive, so build them once per intra-op setting and
+    // time every worker count and batch size on them.
+    std::vector<RunFn> sessions;
+    for (int w = 0; w < workers; ++w)
+      sessions.push_back(factory(intra));
+    for (auto &session : sessions)
+      session(maxBatch); // warm-up: allocations, first-run graph setup
+
+    for (const TuneConfig &config : measure(sessions, intra, batches)) {
+      if (!best || better(config, *best))
+        best = config;
+    }
+  }
+
+  std::cout << "Autotune: selected workers=" << best->workers
+            << " intra=" << best->intraOpThreads << " batch=" << best->batch
+            << std::endl;
+  return *best;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A worker/threading layout and what it measured during calibration.
+struct TuneConfig {
+  int workers = 1;        // Concurrent inference sessions
+  int intraOpThreads = 1; // Threads inside each session
+  int batch = 1;          // Frames per session run
+  double fps = 0;         // Frames per second over all workers
+  double latencyMs = 0;   // Mean duration of one run
+};
+
+// Startup calibration of the inference layout. Each candidate (workers,
+// intra-op threads, batch) runs a few timed rounds on real sessions fed with
+// synthetic frames; the winner is cached per model file and CPU so later
+// runs start right away.
+class AutoTuner {
+public:
+  enum class Objective { Throughput, Latency };
+
+  // Runs one inference of `batch` frames on a session.
+  using RunFn = std::function<void(int batch)>;
+  // Creates a session with `intraOpThreads` threads and returns its runner.
+  using SessionFactory = std::function<RunFn(int intraOpThreads)>;
+
+  AutoTuner(std::string cachePath, Objective objective);
+
+  // Cache key: model content hash, CPU model, core count, engine, objective
+  // and `settings`, the caller's options that change what a run measures.
+  std::string cacheKey(const std::string &modelPath, const std::string &engine,
+                       const std::string &settings) const;
+
+  std::optional<TuneConfig> lookup(const std::string &key) const;
+  void store(const std::string &key, const TuneConfig &config) const;
+
+  // Measures every candidate with at most `maxWorkers` sessions and returns
+  // the best one for the objective. Without `sweepIntraOp` only one intra-op
+  // thread is tried, for sessions whose thread count has no effect (global
+  // thread pool).
+  TuneConfig calibrate(const SessionFactory &factory,
+                       const std::vector<int> &batches, int maxWorkers,
+                       bool sweepIntraOp = true);
+
+  static Objective parseObjective(const std::string &name);
+
+private:
+  std::vector<TuneConfig> measure(const std::vector<RunFn> &sessions,
+                                  int intraOpThreads,
+                                  const std::vector<int> &batches);
+  bool better(const TuneConfig &a, const TuneConfig &b) const;
+
+  std::string cachePath;
+  Objective objective;
+  int runsPerWorker = 4;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Metrics.h"
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+// Recycles the per-frame allocations of the decode thread. YUV frames are
+// copied out of the decoder into buffers from an AVBufferPool, so the
+// decoder's own reference frames are released right away and painting never
+// touches them; the buffers go back to the pool when the encoder frees the
+// AVFrame. BGR Mats are kept in a fixed set and handed out again once every
+// FramePayload referencing them is gone.
+class FramePool {
+public:
+  explicit FramePool(size_t capacity) : capacity(capacity) {}
+
+  ~FramePool() { uninitYuv(); }
+
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  // Upper bound on retained Mats; should cover every payload in flight.
+  void setCapacity(size_t size) {
+    std::lock_guard<std::mutex> lock(mtx);
+    capacity = size;
+  }
+
+  // Returns a pooled copy of `src`; the caller owns the AVFrame and releases
+  // it with av_frame_free(). Safe to call from several decode threads.
+  AVFrame *acquireYuv(const AVFrame *src) {
+    AVFrame *dst = av_frame_alloc();
+    if (!dst)
+      return nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(yuvMtx);
+      if (src->format != format || src->width != width ||
+          src->height != height) {
+        if (!initYuv(src)) {
+          av_frame_free(&dst);
+          return av_frame_clone(src);
+        }
+      }
+      dst->format = format;
+      dst->width = width;
+      dst->height = height;
+
+      // The pool allocates on the thread calling av_buffer_pool_get().
+      allocatedHere = false;
+      for (int i = 0; i < planes; ++i) {
+        dst->buf[i] = av_buffer_pool_get(pools[i]);
+        if (!dst->buf[i]) {
+          av_frame_free(&dst);
+          return av_frame_clone(src);
+        }
+        dst->data[i] = dst->buf[i]->data;
+        dst->linesize[i] = linesizes[i];
+      }
+    }
+    Metrics::getInstance().addYuvPoolAccess(!allocatedHere);
+
+    av_frame_copy(dst, src);
+    av_frame_copy_props(dst, src);
+    return dst;
+  }
+
+  // Returns a rows x cols Mat of `type` whose buffer no payload references.
+  cv::Mat acquireMat(int rows, int cols, int type) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (cv::Mat &mat : mats) {
+      // Only the pool holds a reference: every payload using it is gone.
+      if (mat.u && mat.u->refcount == 1 && mat.rows == rows &&
+          mat.cols == cols && mat.type() == type) {
+        Metrics::getInstance().addMatPoolAccess(true);
+        return mat;
+      }
+    }
+    Metrics::getInstance().addMatPoolAccess(false);
+    cv::Mat mat(rows, cols, type);
+    if (mats.size() < capacity)
+      mats.push_back(mat);
+    return mat;
+  }
+
+private:
+#if LIBAVUTIL_VERSION_MAJOR >= 57
+  using PoolSize = size_t;
+#else
+  using PoolSize = int;
+#endif
+
+  static AVBufferRef *allocBuffer(void *, PoolSize size) {
+    allocatedHere = true;
+    return av_buffer_alloc(size);
+  }
+
+  bool initYuv(const AVFrame *src) {
+    uninitYuv();
+    const AVPixFmtDescriptor *desc =
+        av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format));
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+      return false;
+    if (av_image_fill_linesizes(linesizes,
+                                static_cast<AVPixelFormat>(src->format),
+                                src->width) < 0)
+      return false;
+
+    planes = av_pix_fmt_count_planes(static_cast<AVPixelFormat>(src->format));
+    for (int i = 0; i < planes; ++i) {
+      linesizes[i] = FFALIGN(linesizes[i], 64);
+      int planeHeight = (i == 1 || i == 2)
+                            ? AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h)
+                            : src->height;
+      pools[i] = av_buffer_pool_init2(linesizes[i] * planeHeight + 64,
+                                      nullptr, &FramePool::allocBuffer,
+                                      nullptr);
+      if (!pools[i]) {
+        uninitYuv();
+        return false;
+      }
+    }
+    format = src->format;
+    width = src->width;
+    height = src->height;
+    return true;
+  }
+
+  // Buffers still in flight stay valid; libavutil frees the pool once the
+  // last of them is returned.
+  void uninitYuv() {
+    for (int i = 0; i < planes; ++i)
+      av_buffer_pool_uninit(&pools[i]);
+    planes = 0;
+    format = -1;
+    width = 0;
+    height = 0;
+  }
+
+  size_t capacity;
+
+  AVBufferPool *pools[AV_NUM_DATA_POINTERS] = {};
+  int linesizes[4] = {};
+  int planes = 0;
+  int format = -1;
+  int width = 0;
+  int height = 0;
+  static inline thread_local bool allocatedHere = false;
+
+  std::mutex yuvMtx;
+  std::mutex mtx;
+  std::vector<cv::Mat> mats;
+};
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <iostream>
 #include <mutex>
+#include <string>
 
 class Metrics {
 public:
@@ -18,7 +19,9 @@ public:
 
   void incrementFramesDecoded() { frames_decoded++; }
   void incrementFramesInferred() { frames_inferred++; }
+  void incrementFramesCarried() { frames_carried++; }
   void incrementFramesEncoded() { frames_encoded++; }
+  void incrementSegmentsIngested() { segments_ingested++; }
 
   int getFramesEncoded() const { return frames_encoded.load(); }
 
@@ -32,11 +35,34 @@ public:
     total_time_to_conversion += ms;
   }
 
+  void addDecodeSplit(double demux_ms, double decode_ms) {
+    std::lock_guard<std::mutex> lock(mtx);
+    total_time_to_demux += demux_ms;
+    total_time_to_decode += decode_ms;
+  }
+
+  void addDecodeQueueWait(double ms) {
+    std::lock_guard<std::mutex> lock(mtx);
+    total_decode_queue_wait += ms;
+  }
+
+  void addYuvPoolAccess(bool hit) { (hit ? yuv_pool_hits : yuv_pool_misses)++; }
+  void addMatPoolAccess(bool hit) { (hit ? mat_pool_hits : mat_pool_misses)++; }
+
   void addTimeToInference(double ms) {
     std::lock_guard<std::mutex> lock(mtx);
     total_time_to_inference += ms;
   }
 
+  enum class Stage { Pre, Infer, Post };
+
+  // Per-stage share of the time to inference.
+  void addStageTime(Stage stage, double ms) {
+    std::lock_guard<std::mutex> lock(mtx);
+    total_time_to_inference += ms;
+    total_stage_time[static_cast<int>(stage)] += ms;
+  }
+
   void setFrameSize(int w, int h) {
     frame_width.store(w);
     frame_height.store(h);
@@ -47,6 +73,50 @@ public:
     hw_concurrency.store(concurrency);
   }
 
+  void setDecodeInfo(int threads, const std::string &thread_type) {
+    std::lock_guard<std::mutex> lock(mtx);
+    decode_threads.store(threads);
+    decode_thread_type = thread_type;
+  }
+
+  void setGopInfo(int gops, int decoders) {
+    gop_count.store(gops);
+    gop_decoders.store(decoders);
+  }
+
+  void setSessionInfo(int sessions, int workers, double startup_ms,
+                      double rss_mb) {
+    std::lock_guard<std::mutex> lock(mtx);
+    session_count = sessions;
+    session_workers = workers;
+    session_startup_ms = startup_ms;
+    session_rss_mb = rss_mb;
+  }
+
+  void setSharedPoolInfo(int pool_threads) {
+    shared_pool_threads.store(pool_threads);
+  }
+
+  void setBatchInfo(int max_batch) { max_batch_size.store(max_batch); }
+
+  void addBatch(int frames) {
+    batches_run++;
+    batched_frames += frames;
+  }
+
+  void addTaskRun(bool stolen) {
+    tasks_run++;
+    if (stolen)
+      tasks_stolen++;
+  }
+
+  void setPreprocessInfo(const std::string &mode, int w, int h) {
+    std::lock_guard<std::mutex> lock(mtx);
+    preprocess_mode = mode;
+    preprocess_width.store(w);
+    preprocess_height.store(h);
+  }
+
   void setOptimizationInfo(const std::string &backend,
                            const std::string &precision, int t_width,
                            int t_height, int intra_threads,
@@ -81,20 +151,84 @@ public:
     std::cout << "IntraOp Threads/Worker: " << intra_op_threads.load() << "\n";
     std::cout << "Optimal Threads/Worker: " << optimal_intra_threads.load()
               << "\n";
+    std::cout << "Decode Threads: " << decode_threads.load() << " ("
+              << decode_thread_type << ")\n";
+    if (gop_decoders.load() > 0)
+      std::cout << "GOP-Parallel Decode: " << gop_count.load() << " GOPs on "
+                << gop_decoders.load() << " decoders\n";
+    if (session_count > 0) {
+      std::cout << "Sessions: " << session_count << " for " << session_workers
+                << " workers, startup " << session_startup_ms << " ms, +"
+                << session_rss_mb << " MB RSS\n";
+      if (session_count < session_workers) {
+        // What the sessions not created would have cost at the same rate.
+        int saved = session_workers - session_count;
+        std::cout << "Shared Session Savings: ~"
+                  << saved * session_startup_ms / session_count << " ms, ~"
+                  << saved * session_rss_mb / session_count << " MB\n";
+      }
+    }
+    if (shared_pool_threads.load() > 0)
+      std::cout << "Shared Resources: prepacked weights, "
+                << shared_pool_threads.load() << "-thread global pool\n";
+    if (tasks_run.load() > 0)
+      std::cout << "Stage Tasks: " << tasks_run.load() << " run, "
+                << tasks_stolen.load() << " stolen\n";
+    if (max_batch_size.load() > 1)
+      std::cout << "Batching: " << batches_run.load() << " runs, avg "
+                << static_cast<double>(batched_frames.load()) /
+                       std::max<int>(1, batches_run.load())
+                << " frames (max " << max_batch_size.load() << ")\n";
     std::cout << "Inference Backend: " << inference_backend << " ("
               << model_precision << ")\n";
     std::cout << "Frame Size: " << frame_width.load() << "x"
               << frame_height.load() << "\n";
+    std::cout << "Pre-process: " << preprocess_mode << " ("
+              << preprocess_width.load() << "x" << preprocess_height.load()
+              << " decoder output)\n";
     std::cout << "Tensor Resolution: " << tensor_width.load() << "x"
               << tensor_height.load() << "\n";
     std::cout << "Total Time: " << duration << " ms\n";
+    if (segments_ingested.load() > 0)
+      std::cout << "Segments Ingested: " << segments_ingested.load() << "\n";
     std::cout << "Frames Decoded: " << frames_decoded.load() << "\n";
     std::cout << "Frames Inferred: " << frames_inferred.load() << "\n";
+    if (frames_carried.load() > 0)
+      std::cout << "Frames Carried Forward: " << frames_carried.load() << "\n";
     std::cout << "Frames Encoded: " << frames_encoded.load() << "\n";
     std::cout << "Average FPS: " << fps << "\n";
     std::cout << "Average Time to Frame (T2F): " << avg_t2f << " ms\n";
     std::cout << "Average Time to Conversion (TTC): " << avg_ttc << " ms\n";
     std::cout << "Average Time to Inference (TTI): " << avg_tti << " ms\n";
+    if (total_time_to_inference > 0) {
+      int frames = std::max<int>(1, frames_inferred.load());
+      std::cout << "TTI by Stage: pre " << total_stage_time[0] / frames
+                << " ms, infer " << total_stage_time[1] / frames
+                << " ms, post " << total_stage_time[2] / frames << " ms\n";
+    }
+
+    // Where the decode thread spends its wall time; a large queue wait means
+    // inference is the bottleneck, a large decode share means decode is.
+    // GOP-parallel times are summed over the demux pre-scan and every
+    // decoder, so they are labelled as such rather than as one thread.
+    double decode_total = total_time_to_demux + total_time_to_decode +
+                          total_time_to_conversion + total_decode_queue_wait;
+    if (decode_total > 0) {
+      auto pct = [decode_total](double ms) { return 100.0 * ms / decode_total; };
+      if (gop_decoders.load() > 0)
+        std::cout << "Decode Split (summed over " << gop_decoders.load()
+                  << " GOP decoders): demux " << pct(total_time_to_demux);
+      else
+        std::cout << "Decode Thread Split: demux " << pct(total_time_to_demux);
+      std::cout << "%, decode " << pct(total_time_to_decode) << "%, convert "
+                << pct(total_time_to_conversion) << "%, queue wait "
+                << pct(total_decode_queue_wait) << "%\n";
+    }
+    if (yuv_pool_hits + yuv_pool_misses + mat_pool_hits + mat_pool_misses > 0)
+      std::cout << "Frame Pool: YUV " << yuv_pool_hits.load() << " hits / "
+                << yuv_pool_misses.load() << " misses, Mat "
+                << mat_pool_hits.load() << " hits / " << mat_pool_misses.load()
+                << " misses\n";
     std::cout << "================================\n\n";
   }
 
@@ -110,11 +244,27 @@ private:
 
   std::atomic<int> frames_decoded{0};
   std::atomic<int> frames_inferred{0};
+  std::atomic<int> frames_carried{0};
   std::atomic<int> frames_encoded{0};
+  std::atomic<int> segments_ingested{0};
+
+  std::atomic<int> yuv_pool_hits{0};
+  std::atomic<int> yuv_pool_misses{0};
+  std::atomic<int> mat_pool_hits{0};
+  std::atomic<int> mat_pool_misses{0};
 
   double total_time_to_frame{0};
   double total_time_to_conversion{0};
   double total_time_to_inference{0};
+  double total_time_to_demux{0};
+  double total_time_to_decode{0};
+  double total_decode_queue_wait{0};
+  double total_stage_time[3] = {0, 0, 0};
+  int session_count = 0;
+  int session_workers = 0;
+  double session_startup_ms = 0;
+  double session_rss_mb = 0;
+  std::atomic<int> shared_pool_threads{0};
 
   std::chrono::steady_clock::time_point start_time;
   std::chrono::steady_clock::time_point end_time;
@@ -126,4 +276,16 @@ private:
   std::atomic<int> tensor_height{0};
   std::atomic<int> intra_op_threads{0};
   std::atomic<int> optimal_intra_threads{0};
+  std::atomic<int> decode_threads{0};
+  std::string decode_thread_type{"none"};
+  std::atomic<int> gop_count{0};
+  std::atomic<int> gop_decoders{0};
+  std::atomic<int> max_batch_size{1};
+  std::atomic<int> tasks_run{0};
+  std::atomic<int> tasks_stolen{0};
+  std::atomic<int> batches_run{0};
+  std::atomic<int> batched_frames{0};
+  std::string preprocess_mode{"bgr"};
+  std::atomic<int> preprocess_width{0};
+  std::atomic<int> preprocess_height{0};
 };
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Bounded lock-free multi-producer multi-consumer ring (Vyukov's sequence
+// counter design). Every slot and both cursors sit on their own cache line,
+// items are moved in and out, and a blocked caller spins for a while before
+// parking on a condition variable. Same interface as ThreadSafeQueue, so it
+// can stand in for it; the capacity is rounded up to a power of two.
+template <typename T> class MpmcQueue {
+public:
+  MpmcQueue(size_t maxSize = 100) {
+    size_t size = 2;
+    while (size < maxSize)
+      size <<= 1;
+    mask_ = size - 1;
+    cells_ = new Cell[size];
+    for (size_t i = 0; i < size; ++i)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  ~MpmcQueue() {
+    close();
+    while (tryPop())
+      ;
+    delete[] cells_;
+  }
+
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+  bool push(T item) {
+    if (closed_.load(std::memory_order_acquire))
+      return false;
+    if (spinUntil([&]() { return tryPush(item); })) {
+      wake(popWaiters_, condVarPop_);
+      return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    pushWaiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    condVarPush_.wait(lock, [&]() {
+      return closed_.load(std::memory_order_acquire) ||
+             (pushed = tryPush(item));
+    });
+    pushWaiters_.fetch_sub(1);
+    lock.unlock();
+    if (pushed)
+      wake(popWaiters_, condVarPop_);
+    return pushed;
+  }
+
+  std::optional<T> pop() {
+    return popWait([](auto &cv, auto &lock, auto pred) {
+      cv.wait(lock, pred);
+      return true;
+    });
+  }
+
+  // Like pop(), but gives up at `deadline`; nullopt on timeout or when closed
+  // and drained.
+  std::optional<T> pop_until(std::chrono::steady_clock::time_point deadline) {
+    return popWait([deadline](auto &cv, auto &lock, auto pred) {
+      return cv.wait_until(lock, deadline, pred);
+    });
+  }
+
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(mutex_);
+    condVarPush_.notify_all();
+    condVarPop_.notify_all();
+  }
+
+  bool is_closed() const {
+    return closed_.load(std::memory_order_acquire) && size() == 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  size_t size() const {
+    size_t head = dequeuePos_.load(std::memory_order_acquire);
+    size_t tail = enqueuePos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+private:
+  static constexpr size_t kCacheLine = 64;
+  static constexpr int kMinSpins = 16;
+  static constexpr int kMaxSpins = 4096;
+
+  struct alignas(kCacheLine) Cell {
+    std::atomic<size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static T *item(Cell &cell) {
+    return std::launder(reinterpret_cast<T *>(cell.storage));
+  }
+
+  // Moves `value` in only on success, so a full queue leaves it intact.
+  bool tryPush(T &value) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->storage) T(std::move(value));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> tryPop() {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return std::nullopt; // empty
+      } else {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    T *value = item(*cell);
+    std::optional<T> out(std::move(*value));
+    value->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return out;
+  }
+
+  static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  // Spins with a budget that grows when spinning pays off and shrinks when
+  // the caller ends up parking anyway.
+  template <typename F> bool spinUntil(F &&attempt) {
+    if (!spinning_)
+      return attempt(); // one core: the other side cannot run while we spin
+    int limit = spinLimit_.load(std::memory_order_relaxed);
+    for (int i = 0; i < limit; ++i) {
+      if (attempt()) {
+        if (i > 0)
+          spinLimit_.store(std::min(kMaxSpins, limit * 2),
+                           std::memory_order_relaxed);
+        return true;
+      }
+      if (closed_.load(std::memory_order_acquire))
+        return attempt();
+      cpuRelax();
+    }
+    spinLimit_.store(std::max(kMinSpins, limit / 2),
+                     std::memory_order_relaxed);
+    return false;
+  }
+
+  template <typename Wait> std::optional<T> popWait(Wait &&wait) {
+    std::optional<T> out;
+    if (spinUntil([&]() { return bool(out = tryPop()); })) {
+      wake(pushWaiters_, condVarPush_);
+      return out;
+    }
+
+    // Announce the waiter before the last check; the fence pairs with the
+    // one in wake() so either this check sees the item or the producer sees
+    // the waiter.
+    std::unique_lock<std::mutex> lock(mutex_);
+    popWaiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wait(condVarPop_, lock, [&]() {
+      return bool(out = tryPop()) || closed_.load(std::memory_order_acquire);
+    });
+    popWaiters_.fetch_sub(1);
+    lock.unlock();
+    if (!out && closed_.load(std::memory_order_acquire))
+      out = tryPop(); // drain what was pushed before close()
+    if (out)
+      wake(pushWaiters_, condVarPush_);
+    return out;
+  }
+
+  void wake(std::atomic<int> &waiters, std::condition_variable &cv) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv.notify_one();
+    }
+  }
+
+  Cell *cells_ = nullptr;
+  size_t mask_ = 0;
+
+  alignas(kCacheLine) std::atomic<size_t> enqueuePos_{0};
+  alignas(kCacheLine) std::atomic<size_t> dequeuePos_{0};
+  alignas(kCacheLine) std::atomic<bool> closed_{false};
+  std::atomic<int> spinLimit_{128};
+  const bool spinning_ = std::thread::hardware_concurrency() > 1;
+  std::atomic<int> pushWaiters_{0};
+  std::atomic<int> popWaiters_{0};
+
+  std::mutex mutex_;
+  std::condition_variable condVarPush_;
+  std::condition_variable condVarPop_;
+};
@@ -0,0 +1,212 @@
+#include "RedactKernel.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define REDACT_AVX2 1
+#endif
+
+namespace {
+
+// Bilinear taps along one axis: for each output pixel the two cells it
+// reads and the weight of the second, clamped like cv::resize.
+void buildTaps(int begin, int end, float scale, float offset, int cells,
+               std::vector<int> &i0, std::vector<int> &i1,
+               std::vector<float> &weight) {
+  int n = end - begin;
+  i0.resize(n);
+  i1.resize(n);
+  weight.resize(n);
+  for (int k = 0; k < n; ++k) {
+    float pos = (begin + k) * scale + offset;
+    pos = std::min(std::max(pos, 0.f), float(cells - 1));
+    int i = std::min(int(pos), cells - 1);
+    i0[k] = i;
+    i1[k] = std::min(i + 1, cells - 1);
+    weight[k] = pos - i;
+  }
+}
+
+void maskRowScalar(const float *r0, const float *r1, float fy, const int *i0,
+                   const int *i1, const float *fx, float cut, int begin,
+                   int end, uint8_t *out) {
+  for (int x = begin; x < end; ++x) {
+    float top = r0[i0[x]] + (r0[i1[x]] - r0[i0[x]]) * fx[x];
+    float bottom = r1[i0[x]] + (r1[i1[x]] - r1[i0[x]]) * fx[x];
+    out[x] = top + (bottom - top) * fy > cut ? 0xFF : 0;
+  }
+}
+
+void blendRowScalar(uint8_t *dst, const uint8_t *rep, const uint8_t *mask,
+                    int begin, int end) {
+  for (int x = begin; x < end; ++x)
+    dst[x] = mask[x] ? rep[x] : dst[x];
+}
+
+#ifdef REDACT_AVX2
+bool cpuHasAvx2() {
+  static const bool has =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return has;
+}
+
+// Eight mask bytes per step: gather both taps of both rows, lerp, compare.
+// Returns the first column left for the scalar tail.
+__attribute__((target("avx2,fma"))) int
+maskRowAvx2(const float *r0, const float *r1, float fy, const int *i0,
+            const int *i1, const float *fx, float cut, int end,
+            uint8_t *out) {
+  const __m256 vfy = _mm256_set1_ps(fy);
+  const __m256 vcut = _mm256_set1_ps(cut);
+  int x = 0;
+  for (; x + 8 <= end; x += 8) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(i0 + x));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(i1 + x));
+    __m256 f = _mm256_loadu_ps(fx + x);
+    __m256 t0 = _mm256_i32gather_ps(r0, a, 4);
+    __m256 t1 = _mm256_i32gather_ps(r0, b, 4);
+    __m256 b0 = _mm256_i32gather_ps(r1, a, 4);
+    __m256 b1 = _mm256_i32gather_ps(r1, b, 4);
+    __m256 top = _mm256_fmadd_ps(_mm256_sub_ps(t1, t0), f, t0);
+    __m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(b1, b0), f, b0);
+    __m256 v = _mm256_fmadd_ps(_mm256_sub_ps(bottom, top), vfy, top);
+    __m256i m = _mm256_castps_si256(_mm256_cmp_ps(v, vcut, _CMP_GT_OQ));
+    // All-ones / zero lanes narrow to 0xFF / 0x00 bytes, order kept
+    __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(m),
+                                    _mm256_extracti128_si256(m, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x),
+                     _mm_packs_epi16(words, words));
+  }
+  return x;
+}
+
+__attribute__((target("avx2"))) int blendRowAvx2(uint8_t *dst,
+                                                 const uint8_t *rep,
+                                                 const uint8_t *mask,
+                                                 int end) {
+  int x = 0;
+  for (; x + 32 <= end; x += 32) {
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + x));
+    __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rep + x));
+    __m256i m =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + x));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x),
+                        _mm256_blendv_epi8(d, r, m));
+  }
+  return x;
+}
+#endif // REDACT_AVX2
+
+// Replacement pixels for a plane region; reads the untouched plane.
+void replacement(const cv::Mat &region, RedactMode mode, int blockSize,
+                 uint8_t fill, cv::Mat &out) {
+  switch (mode) {
+  case RedactMode::Fill:
+    out.create(region.size(), CV_8UC1);
+    out.setTo(fill);
+    break;
+  case RedactMode::Pixelate: {
+    cv::Mat small;
+    cv::resize(region, small,
+               cv::Size(std::max(1, region.cols / blockSize),
+                        std::max(1, region.rows / blockSize)),
+               0, 0, cv::INTER_AREA);
+    cv::resize(small, out, region.size(), 0, 0, cv::INTER_NEAREST);
+    break;
+  }
+  case RedactMode::Blur:
+    // region is a view into the plane, so the kernel sees the pixels
+    // around the box too
+    cv::blur(region, out, cv::Size(blockSize, blockSize));
+    break;
+  }
+}
+
+// Paints one plane. (scale, offset) map plane pixels to prototype cells.
+void redactPlane(uint8_t *data, int linesize, int width, int height,
+                 cv::Rect box, const ProtoMask &mask, cv::Point2f scale,
+                 cv::Point2f offset, RedactMode mode, int blockSize,
+                 uint8_t fill) {
+  box &= cv::Rect(0, 0, width, height);
+  if (box.area() == 0)
+    return;
+
+  cv::Mat plane(height, width, CV_8UC1, data, linesize);
+  thread_local cv::Mat rep;
+  replacement(plane(box), mode, std::max(1, blockSize), fill, rep);
+
+  const cv::Mat &logits = mask.logits;
+  thread_local std::vector<int> xi0, xi1;
+  thread_local std::vector<float> xf;
+  thread_local std::vector<int> yi0, yi1;
+  thread_local std::vector<float> yf;
+  thread_local std::vector<uint8_t> row;
+  buildTaps(box.x, box.x + box.width, scale.x, offset.x, logits.cols, xi0,
+            xi1, xf);
+  buildTaps(box.y, box.y + box.height, scale.y, offset.y, logits.rows, yi0,
+            yi1, yf);
+  row.resize(box.width);
+
+#ifdef REDACT_AVX2
+  const bool avx2 = cpuHasAvx2();
+#endif
+  for (int k = 0; k < box.height; ++k) {
+    const float *r0 = logits.ptr<float>(yi0[k]);
+    const float *r1 = logits.ptr<float>(yi1[k]);
+    uint8_t *dst = plane.ptr<uint8_t>(box.y + k) + box.x;
+    const uint8_t *src = rep.ptr<uint8_t>(k);
+
+    int x = 0;
+#ifdef REDACT_AVX2
+    if (avx2)
+      x = maskRowAvx2(r0, r1, yf[k], xi0.data(), xi1.data(), xf.data(),
+                      mask.cut, box.width, row.data());
+#endif
+    maskRowScalar(r0, r1, yf[k], xi0.data(), xi1.data(), xf.data(), mask.cut,
+                  x, box.width, row.data());
+
+    x = 0;
+#ifdef REDACT_AVX2
+    if (avx2)
+      x = blendRowAvx2(dst, src, row.data(), box.width);
+#endif
+    blendRowScalar(dst, src, row.data(), x, box.width);
+  }
+}
+
+} // namespace
+
+RedactMode parseRedactMode(const std::string &name) {
+  if (name == "pixelate")
+    return RedactMode::Pixelate;
+  if (name == "blur")
+    return RedactMode::Blur;
+  return RedactMode::Fill;
+}
+
+void redactYuv420(const YuvPlanes &frame, const cv::Rect &box,
+                  const ProtoMask &mask, RedactMode mode, int blockSize) {
+  if (mask.logits.empty())
+    return;
+
+  // Black: luma floor of the frame's range and neutral chroma.
+  redactPlane(frame.data[0], frame.linesize[0], frame.width, frame.height,
+              box, mask, mask.scale, mask.offset, mode, blockSize,
+              frame.full_range ? 0 : 16);
+
+  // Chroma sample (cx, cy) covers luma 2cx..2cx+1; its center is luma
+  // 2cx + 0.5, so the mapping doubles the scale and shifts by half of it.
+  int chromaWidth = (frame.width + 1) / 2;
+  int chromaHeight = (frame.height + 1) / 2;
+  cv::Rect chromaBox(box.x / 2, box.y / 2,
+                     (box.x + box.width + 1) / 2 - box.x / 2,
+                     (box.y + box.height + 1) / 2 - box.y / 2);
+  cv::Point2f chromaScale(mask.scale.x * 2, mask.scale.y * 2);
+  cv::Point2f chromaOffset(mask.offset.x + mask.scale.x * 0.5f,
+                           mask.offset.y + mask.scale.y * 0.5f);
+  for (int p = 1; p < 3; ++p)
+    redactPlane(frame.data[p], frame.linesize[p], chromaWidth, chromaHeight,
+                chromaBox, mask, chromaScale, chromaOffset, mode,
+                blockSize / 2, 128);
+}
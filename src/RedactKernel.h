@@ -0,0 +1,31 @@
+#pragma once
+
+#include "yolo/yolo_segment.h"
+#include <cstdint>
+#include <string>
+
+// How the masked pixels of a redaction are replaced.
+enum class RedactMode {
+  Fill,     // Black
+  Pixelate, // Mean of each block
+  Blur,     // Box blur
+};
+
+RedactMode parseRedactMode(const std::string &name);
+
+// Writable planes of a YUV 4:2:0 frame, e.g. those of an AVFrame.
+struct YuvPlanes {
+  uint8_t *data[3] = {nullptr, nullptr, nullptr};
+  int linesize[3] = {0, 0, 0};
+  int width = 0;
+  int height = 0;
+  bool full_range = false; // JPEG range: black luma is 0 instead of 16
+};
+
+// Redacts the pixels of `box` that `mask` selects, in place on all three
+// planes. The mask is upsampled and thresholded row by row while painting,
+// so no full-resolution mask is ever built; chroma samples take the mask at
+// the center of their 2x2 luma block. `blockSize` is the pixelate block or
+// blur kernel size in luma pixels, halved on the chroma planes.
+void redactYuv420(const YuvPlanes &frame, const cv::Rect &box,
+                  const ProtoMask &mask, RedactMode mode, int blockSize);
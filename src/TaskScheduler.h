@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for per-frame pipeline stages. Each worker owns a
+// deque: tasks submitted from a worker go to its own deque and are run
+// newest-first (the frame data is still in cache), while idle workers steal
+// the oldest task from another deque. Tasks submitted from outside the pool
+// are spread round-robin. Workers with nothing to run or steal park until
+// the next submit.
+class TaskScheduler {
+public:
+  using Task = std::function<void()>;
+
+  explicit TaskScheduler(int threads) {
+    threads = std::max(1, threads);
+    for (int i = 0; i < threads; ++i)
+      workers.push_back(std::make_unique<Worker>());
+    for (int i = 0; i < threads; ++i)
+      pool.emplace_back([this, i]() { run(i); });
+  }
+
+  ~TaskScheduler() {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(parkMtx);
+      stopping = true;
+    }
+    parkCv.notify_all();
+    for (auto &t : pool)
+      t.join();
+  }
+
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+  void submit(Task task) {
+    pending++;
+    size_t index = currentScheduler == this
+                       ? static_cast<size_t>(currentIndex)
+                       : nextWorker++ % workers.size();
+    {
+      std::lock_guard<std::mutex> lock(workers[index]->mtx);
+      queued++;
+      workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+      // Pairs with the predicate check in run(), so a worker about to park
+      // cannot miss this task.
+      std::lock_guard<std::mutex> lock(parkMtx);
+    }
+    parkCv.notify_one();
+  }
+
+  // Blocks until every submitted task, including tasks submitted by tasks,
+  // has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(parkMtx);
+    idleCv.wait(lock, [this]() { return pending.load() == 0; });
+  }
+
+  int threadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+  struct alignas(64) Worker {
+    std::mutex mtx;
+    std::deque<Task> tasks;
+  };
+
+  bool popLocal(int index, Task &task) {
+    Worker &w = *workers[index];
+    std::lock_guard<std::mutex> lock(w.mtx);
+    if (w.tasks.empty())
+      return false;
+    task = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    queued--;
+    return true;
+  }
+
+  bool steal(int index, Task &task) {
+    size_t n = workers.size();
+    // Start at a different victim each time so thieves spread out.
+    size_t start = (index + 1 + stealSeed++) % n;
+    for (size_t k = 0; k < n; ++k) {
+      size_t victim = (start + k) % n;
+      if (victim == static_cast<size_t>(index))
+        continue;
+      Worker &w = *workers[victim];
+      std::lock_guard<std::mutex> lock(w.mtx);
+      if (w.tasks.empty())
+        continue;
+      task = std::move(w.tasks.front());
+      w.tasks.pop_front();
+      queued--;
+      return true;
+    }
+    return false;
+  }
+
+  void run(int index) {
+    currentScheduler = this;
+    currentIndex = index;
+    while (true) {
+      Task task;
+      bool stolen = false;
+      if (popLocal(index, task) || (stolen = steal(index, task))) {
+        task();
+        Metrics::getInstance().addTaskRun(stolen);
+        if (--pending == 0) {
+          std::lock_guard<std::mutex> lock(parkMtx);
+          idleCv.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(parkMtx);
+      parkCv.wait(lock, [this]() { return stopping || queued.load() > 0; });
+      if (stopping && queued.load() == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> pool;
+
+  std::atomic<size_t> pending{0}; // submitted, not finished
+  std::atomic<size_t> queued{0};  // waiting in a deque
+  std::atomic<size_t> nextWorker{0};
+  std::atomic<size_t> stealSeed{0};
+
+  std::mutex parkMtx;
+  std::condition_variable parkCv;
+  std::condition_variable idleCv;
+  bool stopping = false;
+
+  static inline thread_local TaskScheduler *currentScheduler = nullptr;
+  static inline thread_local int currentIndex = -1;
+};
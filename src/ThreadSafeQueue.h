@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <optional>
@@ -38,6 +39,24 @@ public:
     return std::move(item);
   }
 
+  // Like pop(), but gives up at `deadline`; nullopt on timeout or when closed
+  // and drained.
+  std::optional<T> pop_until(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!condVarPop_.wait_until(lock, deadline, [this]() {
+          return !queue_.empty() || closed_;
+        }))
+      return std::nullopt;
+
+    if (queue_.empty())
+      return std::nullopt;
+
+    T item = std::move(queue_.front());
+    queue_.pop();
+    condVarPush_.notify_one();
+    return std::move(item);
+  }
+
   void close() {
     std::lock_guard<std::mutex> lock(mutex_);
     closed_ = true;
@@ -50,6 +69,8 @@ public:
     return closed_ && queue_.empty();
   }
 
+  size_t capacity() const { return maxSize_; }
+
   size_t size() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return queue_.size();
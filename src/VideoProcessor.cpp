@@ -1,11 +1,25 @@
 #include "VideoProcessor.h"
+#include "AutoTuner.h"
+#include "FramePool.h"
 #include "Metrics.h"
+#include "TaskScheduler.h"
 #include "yolo/yolo.h"
+#include "yolo/yuv_letterbox.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
+#include <unistd.h>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -24,12 +38,317 @@ static void check_error(int result, const std::string &msg) {
   }
 }
 
+// Resident set size of this process, 0 where /proc is not available.
+static double residentMemoryMB() {
+  std::ifstream statm("/proc/self/statm");
+  long pages = 0, resident = 0;
+  if (!(statm >> pages >> resident))
+    return 0;
+  return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) /
+         (1024.0 * 1024.0);
+}
+
+// "0,2,5" -> {0, 2, 5}. A malformed entry or an empty list throws, so a
+// typo never widens redaction to every class.
+static std::vector<int> parseClassList(const std::string &list) {
+  std::vector<int> classes;
+  std::stringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    size_t end = 0;
+    try {
+      classes.push_back(std::stoi(item, &end));
+    } catch (const std::exception &) {
+      end = 0;
+    }
+    if (end == 0 || item.find_first_not_of(" \t", end) != std::string::npos)
+      throw std::runtime_error("Invalid --classes entry: '" + item + "'");
+  }
+  if (classes.empty())
+    throw std::runtime_error("--classes needs at least one class id");
+  return classes;
+}
+
+// Case-insensitive enum value of a CLI flag, e.g. "--precision int8".
+template <typename E>
+static E parseEnumArg(const std::map<std::string, std::string> &args,
+                      const std::string &flag, E fallback) {
+  auto it = args.find(flag);
+  if (it == args.end())
+    return fallback;
+  auto value =
+      magic_enum::enum_cast<E>(it->second, magic_enum::case_insensitive);
+  if (!value)
+    throw std::runtime_error("Invalid " + flag + " value: " + it->second);
+  return *value;
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  out.resize(fs::file_size(path));
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char *>(out.data()), out.size()));
+}
+
+// True when `pkt` starts a closed GOP, so decoding can begin there without
+// any earlier packet: an IDR access unit for H.264/HEVC (a keyframe flag alone
+// may mark an open-GOP I or CRA frame), any keyframe for other codecs.
+static bool isIdrPacket(const AVPacket *pkt, const AVCodecParameters *par) {
+  if (!(pkt->flags & AV_PKT_FLAG_KEY))
+    return false;
+  bool hevc = par->codec_id == AV_CODEC_ID_HEVC;
+  if (par->codec_id != AV_CODEC_ID_H264 && !hevc)
+    return true;
+
+  auto isIdrNal = [hevc](uint8_t header) {
+    if (hevc) {
+      int type = (header >> 1) & 0x3F;
+      return type == 19 || type == 20; // IDR_W_RADL, IDR_N_LP
+    }
+    return (header & 0x1F) == 5;
+  };
+
+  // MP4 stores length-prefixed NAL units (avcC / hvcC extradata), raw
+  // streams use Annex B start codes.
+  int lengthSize = 0;
+  if (par->extradata_size > 4 && par->extradata[0] == 1) {
+    if (!hevc)
+      lengthSize = (par->extradata[4] & 3) + 1;
+    else if (par->extradata_size > 21)
+      lengthSize = (par->extradata[21] & 3) + 1;
+  }
+
+  const uint8_t *p = pkt->data;
+  const uint8_t *end = pkt->data + pkt->size;
+  if (lengthSize) {
+    while (end - p > lengthSize) {
+      uint32_t len = 0;
+      for (int i = 0; i < lengthSize; ++i)
+        len = (len << 8) | p[i];
+      p += lengthSize;
+      if (len == 0 || len > static_cast<uint32_t>(end - p))
+        break;
+      if (isIdrNal(p[0]))
+        return true;
+      p += len;
+    }
+    return false;
+  }
+  for (; end - p > 3; ++p) {
+    if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+      if (isIdrNal(p[3]))
+        return true;
+      p += 2;
+    }
+  }
+  return false;
+}
+
+static bool isKeyFrame(const AVFrame *frame) {
+#ifdef AV_FRAME_FLAG_KEY
+  return frame->flags & AV_FRAME_FLAG_KEY;
+#else
+  return frame->key_frame;
+#endif
+}
+
+// Mean absolute luma difference to the previous frame on a coarse grid. The
+// state is per decode thread; with GOP-parallel decoding a GOP stays on one
+// thread and its first frame is a keyframe anyway.
+static bool isSceneCut(const AVFrame *frame) {
+  constexpr int grid = 32;
+  constexpr int threshold = 30;
+  thread_local std::vector<uint8_t> previous;
+  std::vector<uint8_t> current(grid * grid);
+  for (int gy = 0; gy < grid; ++gy) {
+    const uint8_t *row =
+        frame->data[0] + (gy * frame->height / grid) * frame->linesize[0];
+    for (int gx = 0; gx < grid; ++gx)
+      current[gy * grid + gx] = row[gx * frame->width / grid];
+  }
+  bool cut = false;
+  if (previous.size() == current.size()) {
+    int diff = 0;
+    for (int i = 0; i < grid * grid; ++i)
+      diff += std::abs(current[i] - previous[i]);
+    cut = diff > threshold * grid * grid;
+  }
+  previous.swap(current);
+  return cut;
+}
+
+// Luma at quarter resolution, the reference for carry-forward motion.
+static cv::Mat motionThumbnail(const AVFrame *frame) {
+  cv::Mat y(frame->height, frame->width, CV_8UC1, frame->data[0],
+            frame->linesize[0]);
+  cv::Mat thumb;
+  cv::resize(y, thumb, cv::Size(), 0.25, 0.25, cv::INTER_AREA);
+  thumb.convertTo(thumb, CV_32F);
+  return thumb;
+}
+
+// Moves each redaction by the motion of its content between `ref` and
+// `current` (quarter-resolution luma), clipped to the frame.
+static std::vector<Redaction> shiftRedactions(const std::vector<Redaction> &in,
+                                              const cv::Mat &ref,
+                                              const cv::Mat &current,
+                                              const cv::Size &frameSize) {
+  std::vector<Redaction> out;
+  cv::Rect frameRect(cv::Point(0, 0), frameSize);
+  for (const auto &r : in) {
+    cv::Point shift(0, 0);
+    cv::Rect roi(r.box.x / 4, r.box.y / 4, r.box.width / 4, r.box.height / 4);
+    roi &= cv::Rect(0, 0, ref.cols, ref.rows);
+    if (roi.width >= 8 && roi.height >= 8 && current.size() == ref.size()) {
+      double response = 0;
+      cv::Point2d d =
+          cv::phaseCorrelate(ref(roi), current(roi), cv::noArray(), &response);
+      if (response > 0.1)
+        shift = cv::Point(cvRound(d.x * 4), cvRound(d.y * 4));
+    }
+    cv::Rect moved = r.box + shift;
+    cv::Rect clipped = moved & frameRect;
+    if (clipped.area() == 0)
+      continue;
+    // The mask is a mapping, not pixels: moving it only moves its origin.
+    Redaction s;
+    s.box = clipped;
+    s.mask = r.mask;
+    s.mask.offset.x -= shift.x * r.mask.scale.x;
+    s.mask.offset.y -= shift.y * r.mask.scale.y;
+    out.push_back(s);
+  }
+  return out;
+}
+
+static void paintRedactions(AVFrame *yuvFrame,
+                            const std::vector<Redaction> &redactions,
+                            RedactMode mode, int blockSize) {
+  YuvPlanes planes;
+  for (int p = 0; p < 3; ++p) {
+    planes.data[p] = yuvFrame->data[p];
+    planes.linesize[p] = yuvFrame->linesize[p];
+  }
+  planes.width = yuvFrame->width;
+  planes.height = yuvFrame->height;
+  planes.full_range = yuvFrame->format == AV_PIX_FMT_YUVJ420P ||
+                      yuvFrame->color_range == AVCOL_RANGE_JPEG;
+
+  // Create zero-copy cv::Mat wrapper around the hardware Y-plane (Luminance)
+  cv::Mat y_plane(yuvFrame->height, yuvFrame->width, CV_8UC1, yuvFrame->data[0],
+                  yuvFrame->linesize[0]);
+  for (const auto &r : redactions) {
+    if (!r.mask.logits.empty()) {
+      redactYuv420(planes, r.box, r.mask, mode, blockSize);
+    } else {
+      cv::rectangle(y_plane, r.box, cv::Scalar(0), 4);
+    }
+  }
+}
+
+// Read-only virtual stream over a list of in-memory chunks (e.g. the DASH init
+// segment followed by a media segment). libavformat sees the chunks as one
+// contiguous file, so nothing has to be concatenated on disk.
+struct SegmentStream {
+  std::deque<std::vector<uint8_t>> chunks;
+  int64_t base = 0; // stream offset of chunks.front()
+  int64_t size = 0;
+  int64_t pos = 0;
+
+  // A live stream grows while it is read: read() blocks for more data until
+  // close(), consumed chunks are dropped and seeking is not supported.
+  bool live = false;
+  bool closed = false;
+  std::mutex mtx;
+  std::condition_variable dataReady;
+
+  void append(std::vector<uint8_t> chunk) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size += chunk.size();
+    chunks.push_back(std::move(chunk));
+    dataReady.notify_all();
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    dataReady.notify_all();
+  }
+
+  static int read(void *opaque, uint8_t *buf, int bufSize) {
+    auto *stream = static_cast<SegmentStream *>(opaque);
+    std::unique_lock<std::mutex> lock(stream->mtx);
+    if (stream->live)
+      stream->dataReady.wait(lock, [stream]() {
+        return stream->pos < stream->size || stream->closed;
+      });
+
+    int copied = 0;
+    int64_t chunkStart = stream->base;
+    for (const auto &chunk : stream->chunks) {
+      int64_t chunkEnd = chunkStart + chunk.size();
+      if (stream->pos < chunkEnd) {
+        int64_t n = std::min<int64_t>(chunkEnd - stream->pos, bufSize - copied);
+        std::memcpy(buf + copied, chunk.data() + (stream->pos - chunkStart), n);
+        copied += n;
+        stream->pos += n;
+        if (copied == bufSize)
+          break;
+      }
+      chunkStart = chunkEnd;
+    }
+
+    if (stream->live) {
+      while (!stream->chunks.empty()) {
+        int64_t frontEnd = stream->base + stream->chunks.front().size();
+        if (frontEnd > stream->pos)
+          break;
+        stream->base = frontEnd;
+        stream->chunks.pop_front();
+      }
+    }
+    return copied > 0 ? copied : AVERROR_EOF;
+  }
+
+  static int64_t seek(void *opaque, int64_t offset, int whence) {
+    auto *stream = static_cast<SegmentStream *>(opaque);
+    std::lock_guard<std::mutex> lock(stream->mtx);
+    if (whence & AVSEEK_SIZE)
+      return stream->size;
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = stream->pos + offset;
+      break;
+    case SEEK_END:
+      target = stream->size + offset;
+      break;
+    default:
+      return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > stream->size)
+      return AVERROR(EINVAL);
+    stream->pos = target;
+    return target;
+  }
+};
+
 class VideoDecoder {
 public:
   explicit VideoDecoder(const std::string &inputPath) : inputPath(inputPath) {
     packet = av_packet_alloc();
     frame = av_frame_alloc();
-    frameBGR = av_frame_alloc();
+  }
+
+  // Decodes from memory through a custom AVIOContext instead of a file.
+  explicit VideoDecoder(std::unique_ptr<SegmentStream> stream)
+      : VideoDecoder(std::string()) {
+    this->stream = std::move(stream);
   }
 
   ~VideoDecoder() {
@@ -39,8 +358,10 @@ public:
       avcodec_free_context(&codecCtx);
     if (fmtCtx)
       avformat_close_input(&fmtCtx);
-    if (frameBGR)
-      av_frame_free(&frameBGR);
+    if (avioCtx) {
+      av_freep(&avioCtx->buffer);
+      avio_context_free(&avioCtx);
+    }
     if (frame)
       av_frame_free(&frame);
     if (packet)
@@ -48,7 +369,27 @@ public:
   }
 
   bool open() {
-    if (avformat_open_input(&fmtCtx, inputPath.c_str(), nullptr, nullptr) < 0)
+    if (stream) {
+      constexpr int ioBufferSize = 64 * 1024;
+      auto *ioBuffer = static_cast<unsigned char *>(av_malloc(ioBufferSize));
+      if (!ioBuffer)
+        return false;
+      avioCtx = avio_alloc_context(ioBuffer, ioBufferSize, 0, stream.get(),
+                                   &SegmentStream::read, nullptr,
+                                   stream->live ? nullptr
+                                                : &SegmentStream::seek);
+      if (!avioCtx) {
+        av_free(ioBuffer);
+        return false;
+      }
+      if (stream->live)
+        avioCtx->seekable = 0;
+      fmtCtx = avformat_alloc_context();
+      fmtCtx->pb = avioCtx;
+      fmtCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    if (avformat_open_input(&fmtCtx, stream ? nullptr : inputPath.c_str(),
+                            nullptr, nullptr) < 0)
       return false;
     if (avformat_find_stream_info(fmtCtx, nullptr) < 0)
       return false;
@@ -62,58 +403,290 @@ public:
     if (videoStreamIdx == -1)
       return false;
 
-    AVCodecParameters *codecPar = fmtCtx->streams[videoStreamIdx]->codecpar;
-    const AVCodec *decoder = avcodec_find_decoder(codecPar->codec_id);
-    codecCtx = avcodec_alloc_context3(decoder);
-    avcodec_parameters_to_context(codecCtx, codecPar);
-    avcodec_open2(codecCtx, decoder, nullptr);
+    codecCtx = openCodecContext(threadCount);
+    if (!codecCtx)
+      return false;
 
-    frameBGR->format = AV_PIX_FMT_BGR24;
-    frameBGR->width = codecCtx->width;
-    frameBGR->height = codecCtx->height;
-    av_frame_get_buffer(frameBGR, 0);
+    // The fused YOLO pre-process reads 8-bit 4:2:0 planes directly; any other
+    // layout still goes through swscale.
+    if (codecCtx->pix_fmt != AV_PIX_FMT_YUV420P &&
+        codecCtx->pix_fmt != AV_PIX_FMT_YUVJ420P)
+      convertToBGR = true;
+    if (!convertToBGR)
+      return true;
+
+    // Scale straight to the letterboxed inference size when that is smaller
+    // than the stream; the decoded AVFrame keeps the full resolution.
+    outWidth = codecCtx->width;
+    outHeight = codecCtx->height;
+    if (!fitSize.empty()) {
+      LetterBoxInfo box =
+          letterbox_info(cv::Size(codecCtx->width, codecCtx->height), fitSize);
+      if (box.ratio < 1.f) {
+        outWidth = box.width;
+        outHeight = box.height;
+      }
+    }
 
-    swsCtx =
-        sws_getContext(codecCtx->width, codecCtx->height, codecCtx->pix_fmt,
-                       codecCtx->width, codecCtx->height, AV_PIX_FMT_BGR24,
-                       SWS_BILINEAR, nullptr, nullptr, nullptr);
+    swsCtx = createSwsContext();
     return true;
   }
 
   bool readFrame(cv::Mat &outFrame, AVFrame *&outYuvFrame, int64_t &outPts) {
-    auto t0 = std::chrono::high_resolution_clock::now();
+    using clock = std::chrono::high_resolution_clock;
+    auto t0 = clock::now();
+    double demux_time = 0;
+
+    // Drain the decoder before feeding it: with frame threading (and B-frame
+    // reordering) one packet does not map to one frame, and the last frames
+    // only come out after the flush packet.
+    int ret;
+    while ((ret = avcodec_receive_frame(codecCtx, frame)) == AVERROR(EAGAIN)) {
+      auto td0 = clock::now();
+      int read = av_read_frame(fmtCtx, packet);
+      demux_time +=
+          std::chrono::duration<double, std::milli>(clock::now() - td0).count();
+      if (read < 0) {
+        avcodec_send_packet(codecCtx, nullptr);
+        continue;
+      }
+      if (packet->stream_index == videoStreamIdx)
+        avcodec_send_packet(codecCtx, packet);
+      av_packet_unref(packet);
+    }
+    if (ret < 0)
+      return false;
+
+    auto t1 = clock::now();
+    double read_time =
+        std::chrono::duration<double, std::milli>(t1 - t0).count();
+    Metrics::getInstance().addTimeToFrame(read_time);
+    Metrics::getInstance().addDecodeSplit(demux_time, read_time - demux_time);
+
+    convertFrame(frame, swsCtx, outFrame, outYuvFrame);
+    outPts = frame->pts;
+    av_frame_unref(frame);
+
+    auto t2 = clock::now();
+    double conv_time =
+        std::chrono::duration<double, std::milli>(t2 - t1).count();
+    Metrics::getInstance().addTimeToConversion(conv_time);
+    Metrics::getInstance().incrementFramesDecoded();
+
+    return true;
+  }
+
+  // Returns false to stop decoding: every later sequence number is unwanted.
+  using FrameSink = std::function<bool(cv::Mat &frame, AVFrame *yuvFrame,
+                                       int64_t pts, int64_t seq)>;
+
+  // Decodes the rest of the input GOP-parallel, as an alternative to
+  // readFrame(). Video packets are pre-scanned into memory and split at IDR
+  // frames; `workers` threads then decode whole GOPs, each with its own codec
+  // context, and hand every frame to `sink` (from the worker thread) with its
+  // presentation-order sequence number. Frames of different GOPs arrive out
+  // of order. A frame that fails to decode still takes its number: `sink`
+  // gets a null yuvFrame for it, so the reorder stage never waits for it.
+  // The decoder thread count set by setThreading() is divided among the
+  // workers.
+  int decodeGopParallel(int workers, const FrameSink &sink) {
+    using clock = std::chrono::high_resolution_clock;
+    auto t0 = clock::now();
+
+    AVCodecParameters *codecPar = fmtCtx->streams[videoStreamIdx]->codecpar;
+    std::vector<AVPacket *> packets;
+    std::vector<size_t> gopStarts;
     while (av_read_frame(fmtCtx, packet) >= 0) {
       if (packet->stream_index == videoStreamIdx) {
-        if (avcodec_send_packet(codecCtx, packet) == 0) {
-          if (avcodec_receive_frame(codecCtx, frame) == 0) {
-            auto t1 = std::chrono::high_resolution_clock::now();
-            double read_time =
-                std::chrono::duration<double, std::milli>(t1 - t0).count();
-            Metrics::getInstance().addTimeToFrame(read_time);
-
-            sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height,
-                      frameBGR->data, frameBGR->linesize);
-
-            outFrame = cv::Mat(frame->height, frame->width, CV_8UC3,
-                               frameBGR->data[0], frameBGR->linesize[0])
-                           .clone();
-            outYuvFrame = av_frame_clone(frame);
-            outPts = frame->pts;
-            av_packet_unref(packet);
-
-            auto t2 = std::chrono::high_resolution_clock::now();
-            double conv_time =
-                std::chrono::duration<double, std::milli>(t2 - t1).count();
-            Metrics::getInstance().addTimeToConversion(conv_time);
-            Metrics::getInstance().incrementFramesDecoded();
-
-            return true;
-          }
-        }
+        if (packets.empty() || isIdrPacket(packet, codecPar))
+          gopStarts.push_back(packets.size());
+        packets.push_back(av_packet_clone(packet));
       }
       av_packet_unref(packet);
     }
-    return false;
+    gopStarts.push_back(packets.size());
+    size_t gopCount = gopStarts.size() - 1;
+    Metrics::getInstance().addDecodeSplit(
+        std::chrono::duration<double, std::milli>(clock::now() - t0).count(),
+        0);
+
+    // A closed GOP decodes to the frames of its packets, so a frame's
+    // sequence number is the rank of its pts among all packet pts, and each
+    // GOP owns the ranks of its own packets. Without a unique pts on every
+    // packet the GOPs are decoded in order on one context and numbered as
+    // they come out, like readFrame().
+    std::vector<int64_t> ranks;
+    for (AVPacket *pkt : packets)
+      ranks.push_back(pkt->pts);
+    std::sort(ranks.begin(), ranks.end());
+    bool byPts = std::adjacent_find(ranks.begin(), ranks.end()) ==
+                     ranks.end() &&
+                 (ranks.empty() || ranks.front() != AV_NOPTS_VALUE);
+    if (!byPts) {
+      std::cerr << "GOP-parallel decoding needs a unique pts on every "
+                   "packet, decoding sequentially"
+                << std::endl;
+      workers = 1;
+    }
+    auto rankOf = [&ranks](int64_t pts) {
+      return std::lower_bound(ranks.begin(), ranks.end(), pts) -
+             ranks.begin();
+    };
+
+    int threadsPerContext = std::max(1, threadCount / workers);
+    std::atomic<size_t> nextGop{0};
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> lost{0}, unexpected{0};
+    int64_t sequentialSeq = 0; // !byPts only, a single worker
+    auto decodeGops = [&]() {
+      AVCodecContext *ctx = openCodecContext(threadsPerContext);
+      if (!ctx)
+        return;
+      SwsContext *sws = convertToBGR ? createSwsContext() : nullptr;
+      AVFrame *decoded = av_frame_alloc();
+      double decodeTime = 0;
+
+      // GOPs are taken in order, so once the sink refuses a frame no later
+      // GOP is wanted either.
+      for (size_t g; !stop && (g = nextGop++) < gopCount;) {
+        // Sequence numbers of this GOP's frames, and which ones arrived.
+        std::vector<int64_t> gopSeqs;
+        for (size_t p = gopStarts[g]; byPts && p < gopStarts[g + 1]; ++p)
+          gopSeqs.push_back(rankOf(packets[p]->pts));
+        std::sort(gopSeqs.begin(), gopSeqs.end());
+        std::vector<char> arrived(gopSeqs.size(), 0);
+        bool refused = false;
+
+        for (size_t p = gopStarts[g]; p <= gopStarts[g + 1] && !refused;
+             ++p) {
+          // The extra iteration sends the flush packet ending the GOP.
+          AVPacket *pkt = p < gopStarts[g + 1] ? packets[p] : nullptr;
+          bool sent = false;
+          while (!sent) {
+            auto td0 = clock::now();
+            int ret = avcodec_send_packet(ctx, pkt);
+            sent = ret != AVERROR(EAGAIN);
+            while ((ret = avcodec_receive_frame(ctx, decoded)) == 0) {
+              decodeTime += std::chrono::duration<double, std::milli>(
+                                clock::now() - td0)
+                                .count();
+              Metrics::getInstance().addTimeToFrame(decodeTime);
+              Metrics::getInstance().addDecodeSplit(0, decodeTime);
+              decodeTime = 0;
+
+              auto tc0 = clock::now();
+              cv::Mat bgr;
+              AVFrame *yuv = nullptr;
+              convertFrame(decoded, sws, bgr, yuv);
+              int64_t pts = decoded->pts;
+              av_frame_unref(decoded);
+              Metrics::getInstance().addTimeToConversion(
+                  std::chrono::duration<double, std::milli>(clock::now() -
+                                                            tc0)
+                      .count());
+              Metrics::getInstance().incrementFramesDecoded();
+
+              int64_t seq;
+              if (byPts) {
+                // A frame whose pts is not one of this GOP's packets, or a
+                // second frame with the same pts, has no number of its own.
+                int64_t rank = rankOf(pts);
+                auto it = std::lower_bound(gopSeqs.begin(), gopSeqs.end(),
+                                           rank);
+                size_t k = it - gopSeqs.begin();
+                if (it == gopSeqs.end() || *it != rank || ranks[rank] != pts ||
+                    arrived[k]) {
+                  unexpected++;
+                  av_frame_free(&yuv);
+                  td0 = clock::now();
+                  continue;
+                }
+                arrived[k] = 1;
+                seq = rank;
+              } else {
+                seq = sequentialSeq++;
+              }
+              if (!sink(bgr, yuv, pts, seq)) {
+                refused = true;
+                stop = true;
+                break;
+              }
+              td0 = clock::now();
+            }
+            if (refused)
+              break;
+            decodeTime +=
+                std::chrono::duration<double, std::milli>(clock::now() - td0)
+                    .count();
+          }
+        }
+        avcodec_flush_buffers(ctx);
+
+        // Frames that never came out keep their place in the sequence.
+        for (size_t k = 0; k < gopSeqs.size() && !refused; ++k) {
+          if (arrived[k])
+            continue;
+          lost++;
+          cv::Mat none;
+          if (!sink(none, nullptr, AV_NOPTS_VALUE, gopSeqs[k])) {
+            stop = true;
+            break;
+          }
+        }
+      }
+
+      av_frame_free(&decoded);
+      if (sws)
+        sws_freeContext(sws);
+      avcodec_free_context(&ctx);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::min<int>(workers, gopCount); ++i)
+      threads.emplace_back(decodeGops);
+    for (auto &t : threads)
+      t.join();
+
+    for (AVPacket *pkt : packets)
+      av_packet_free(&pkt);
+    if (lost || unexpected)
+      std::cerr << "GOP-parallel decoding: " << lost << " frames failed to "
+                << "decode, " << unexpected << " unexpected frames dropped"
+                << std::endl;
+    return static_cast<int>(gopCount);
+  }
+
+  // Must be called before open(). threads == 0 lets libavcodec pick.
+  void setThreading(int threads, int type) {
+    threadCount = threads;
+    threadType = type;
+  }
+
+  // Must be called before open(). Without BGR conversion readFrame() returns
+  // an empty cv::Mat and consumers work on the YUV frame.
+  void setConvertToBGR(bool convert) { convertToBGR = convert; }
+  bool getConvertToBGR() const { return convertToBGR; }
+
+  // Must be called before open(). The BGR frame is downscaled to fit inside
+  // `size` with the letterbox geometry of the YOLO pre-process.
+  void setScaleToFit(const cv::Size &size) { fitSize = size; }
+  int getOutputWidth() const {
+    return convertToBGR ? outWidth : codecCtx->width;
+  }
+  int getOutputHeight() const {
+    return convertToBGR ? outHeight : codecCtx->height;
+  }
+
+  // Number of frames that can be in flight downstream of the decoder.
+  void setPoolCapacity(size_t capacity) { framePool.setCapacity(capacity); }
+
+  int getThreadCount() const { return codecCtx->thread_count; }
+  std::string getThreadType() const {
+    if (codecCtx->active_thread_type & FF_THREAD_FRAME)
+      return "frame";
+    if (codecCtx->active_thread_type & FF_THREAD_SLICE)
+      return "slice";
+    return "none";
   }
 
   int getWidth() const { return codecCtx->width; }
@@ -124,14 +697,61 @@ public:
   AVStream *getStream() const { return fmtCtx->streams[videoStreamIdx]; }
 
 private:
+  AVCodecContext *openCodecContext(int threads) {
+    AVCodecParameters *codecPar = fmtCtx->streams[videoStreamIdx]->codecpar;
+    const AVCodec *decoder = avcodec_find_decoder(codecPar->codec_id);
+    if (!decoder)
+      return nullptr;
+    AVCodecContext *ctx = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(ctx, codecPar);
+    ctx->thread_count = threads;
+    ctx->thread_type = threadType;
+    if (avcodec_open2(ctx, decoder, nullptr) < 0) {
+      avcodec_free_context(&ctx);
+      return nullptr;
+    }
+    return ctx;
+  }
+
+  SwsContext *createSwsContext() const {
+    return sws_getContext(codecCtx->width, codecCtx->height, codecCtx->pix_fmt,
+                          outWidth, outHeight, AV_PIX_FMT_BGR24, SWS_BILINEAR,
+                          nullptr, nullptr, nullptr);
+  }
+
+  // Copies a decoded frame into pooled buffers, plus the scaled BGR frame
+  // when convertToBGR. `sws` is per thread: SwsContext is not thread-safe.
+  void convertFrame(const AVFrame *src, SwsContext *sws, cv::Mat &outFrame,
+                    AVFrame *&outYuvFrame) {
+    if (convertToBGR) {
+      // Scale straight into a recycled Mat instead of cloning a staging frame
+      outFrame = framePool.acquireMat(outHeight, outWidth, CV_8UC3);
+      uint8_t *dst[4] = {outFrame.data, nullptr, nullptr, nullptr};
+      int dstStride[4] = {static_cast<int>(outFrame.step), 0, 0, 0};
+      sws_scale(sws, src->data, src->linesize, 0, src->height, dst,
+                dstStride);
+    } else {
+      outFrame = cv::Mat();
+    }
+    outYuvFrame = framePool.acquireYuv(src);
+  }
+
   std::string inputPath;
+  std::unique_ptr<SegmentStream> stream;
+  AVIOContext *avioCtx = nullptr;
   AVFormatContext *fmtCtx = nullptr;
   AVCodecContext *codecCtx = nullptr;
   SwsContext *swsCtx = nullptr;
   int videoStreamIdx = -1;
+  int threadCount = 1;
+  int threadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  bool convertToBGR = true;
+  cv::Size fitSize;
+  int outWidth = 0;
+  int outHeight = 0;
   AVPacket *packet = nullptr;
   AVFrame *frame = nullptr;
-  AVFrame *frameBGR = nullptr;
+  FramePool framePool{128};
 };
 
 class VideoEncoder {
@@ -190,6 +810,11 @@ public:
     av_dict_set(&opts, "seg_duration", "2", 0);
     av_dict_set(&opts, "init_seg_name", "init.mp4", 0);
     av_dict_set(&opts, "media_seg_name", "chunk-$Number$.m4s", 0);
+    if (live) {
+      // Write each frame as its own fragment so a segment is on disk as soon
+      // as its last frame is encoded.
+      av_dict_set(&opts, "streaming", "1", 0);
+    }
 
     if (!(fmtCtx->oformat->flags & AVFMT_NOFILE)) {
       if (avio_open(&fmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0)
@@ -210,6 +835,9 @@ public:
     return true;
   }
 
+  // Must be called before open(); the MPD stays dynamic until flush().
+  void setLive(bool enable) { live = enable; }
+
   void writeFrame(AVFrame *yuvFrame, int64_t pts) {
     yuvFrame->pts = pts;
 
@@ -249,6 +877,7 @@ private:
   SwsContext *swsCtx = nullptr;
   AVPacket *packet = nullptr;
   AVFrame *encFrame = nullptr;
+  bool live = false;
 };
 
 // --- Video Processor Class ---
@@ -263,43 +892,149 @@ VideoProcessor::VideoProcessor(const std::map<std::string, std::string> &args)
     use_optimization = std::stoi(args.at("--optimize")) == 1;
   }
 
+  // Classes to redact. The list is pushed down into the detector, which then
+  // reads only these class rows and runs NMS and mask assembly on their
+  // candidates alone.
+  if (args.find("--classes") != args.end()) {
+    redactClasses = parseClassList(args.at("--classes"));
+  }
+
+  // Model description: algorithm family, weight precision and head. Detect
+  // models redact whole boxes, segment models their masks.
+  yoloAlgo = parseEnumArg(args, "--algo", yoloAlgo);
+  yoloPrecision = parseEnumArg(args, "--precision", yoloPrecision);
+  yoloTask = parseEnumArg(args, "--task", yoloTask);
+  if (yoloTask != Detect && yoloTask != Segment)
+    throw std::runtime_error("--task must be detect or segment");
+
+  // Fast NMS by default; it keeps the same boxes as the reference
+  // implementation, which stays selectable for comparison. The top-k cap on
+  // the candidates ranked per frame is opt-in, since it can change the
+  // result.
+  if (args.find("--nms") != args.end()) {
+    nmsType = args.at("--nms") == "reference" ? NMS_Type::Reference
+                                              : NMS_Type::Fast;
+  }
+  if (args.find("--nms-topk") != args.end()) {
+    nmsTopK = std::max(0, std::stoi(args.at("--nms-topk")));
+  }
+  if (args.find("--nms-class-aware") != args.end()) {
+    nmsClassAware = args.at("--nms-class-aware") == "1";
+  }
+
+  // Shared resources: every session of the engine uses one prepacked-weights
+  // container and one global intra-op pool instead of private copies. The
+  // session-running threads do work too, so the pool gets the cores they
+  // leave over. Set before the first session is built, including autotune's.
+  if (args.count("--shared-resources") &&
+      args.at("--shared-resources") == "1") {
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    int poolThreads =
+        std::max(1, cores - (engineType == "yolo" ? cores / 2 : cores / 10));
+    if (args.find("--pool-threads") != args.end()) {
+      poolThreads = std::max(1, std::stoi(args.at("--pool-threads")));
+    }
+    if (engineType == "yolo") {
+      YOLO::set_shared_resources(poolThreads);
+    } else {
+      GroundingDINO::set_shared_resources(poolThreads);
+    }
+    Metrics::getInstance().setSharedPoolInfo(poolThreads);
+    sharedPoolThreads = poolThreads;
+  }
+
+  // Optional startup calibration of workers x IntraOp threads x batch; the
+  // result replaces the defaults below.
+  std::optional<TuneConfig> tuned;
+  if (args.find("--autotune") != args.end() && args.at("--autotune") != "0") {
+    tuned = autotune(modelPath, use_optimization);
+  }
+
   if (engineType == "yolo") {
     numInferenceThreads = std::max(1u, std::thread::hardware_concurrency() /
                                            2); // default scaling
     int optimalYoloThreads =
         1; // YOLO optimally runs 1 IntraOp thread under scaling
+    intraOpThreads = optimalYoloThreads;
+
+    // Batched inference: fewer sessions, each running B frames per call
+    // with B IntraOp threads, so the core budget stays the same.
+    if (args.find("--batch") != args.end()) {
+      batchSize = std::max(1, std::stoi(args.at("--batch")));
+    }
+    if (args.find("--batch-wait-ms") != args.end()) {
+      batchWaitMs = std::max(0, std::stoi(args.at("--batch-wait-ms")));
+    }
+    const int unbatchedThreads = numInferenceThreads;
+    if (batchSize > 1) {
+      numInferenceThreads = std::max(1, numInferenceThreads / batchSize);
+      intraOpThreads = batchSize;
+    }
+    if (tuned) {
+      numInferenceThreads = tuned->workers;
+      intraOpThreads = tuned->intraOpThreads;
+      optimalYoloThreads = tuned->intraOpThreads;
+      batchSize = tuned->batch;
+    }
+    // Shared mode: one session whose Run() every inference thread calls
+    // concurrently, so weights and graph are loaded once and only per-frame
+    // tensors are per thread.
+    bool sharedSession =
+        args.count("--shared-session") && args.at("--shared-session") == "1";
+    double rss0 = residentMemoryMB();
+    auto t0 = std::chrono::steady_clock::now();
+    yoloPool.push_back(createYolo(modelPath, intraOpThreads));
+    // A fixed batch dimension makes process_frames run frame by frame, so
+    // the batched split would only cost sessions: go back to the defaults.
+    if (batchSize > 1 && !yoloPool.front()->supports_batch()) {
+      std::cerr << "Warning: model has a fixed batch dimension, ignoring batch "
+                << batchSize << std::endl;
+      batchSize = 1;
+      numInferenceThreads = unbatchedThreads;
+      optimalYoloThreads = 1;
+      if (intraOpThreads != optimalYoloThreads) {
+        intraOpThreads = optimalYoloThreads;
+        yoloPool.front() = createYolo(modelPath, intraOpThreads);
+      }
+    }
+    Metrics::getInstance().setBatchInfo(batchSize);
     Metrics::getInstance().setThreadInfo(numInferenceThreads,
                                          std::thread::hardware_concurrency());
-    Metrics::getInstance().setOptimizationInfo("ONNXRuntime CPU", "FP32", 640,
-                                               640, 1, optimalYoloThreads);
-    for (int i = 0; i < numInferenceThreads; ++i) {
-      std::unique_ptr<YOLO> base_yolo = CreateFactory::instance().create(
-          Backend_Type::ONNXRuntime, Task_Type::Segment);
-
-      if (!base_yolo) {
-        throw std::runtime_error("Failed to create YOLO model instance.");
-      }
-
-      auto yolo_instance = std::unique_ptr<YOLO_Segment>(
-          dynamic_cast<YOLO_Segment *>(base_yolo.release()));
-
-      // Defaulting to CPU FP32 for now
-      yolo_instance->init(YOLOv8, CPU, FP32, modelPath);
-      yoloPool.push_back(std::move(yolo_instance));
+    int sessionCount = sharedSession ? 1 : numInferenceThreads;
+    for (int i = 1; i < sessionCount; ++i) {
+      yoloPool.push_back(createYolo(modelPath, intraOpThreads));
     }
+    cv::Size inputSize = yoloPool.front()->get_input_size();
+    Metrics::getInstance().setOptimizationInfo(
+        "ONNXRuntime CPU", std::string(magic_enum::enum_name(yoloPrecision)),
+        inputSize.width, inputSize.height, intraOpThreads, optimalYoloThreads);
+    Metrics::getInstance().setSessionInfo(
+        sessionCount, numInferenceThreads,
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0)
+            .count(),
+        residentMemoryMB() - rss0);
   } else if (engineType == "dino") {
     // GroundingDINO relies on heavy self-attention mechanisms mapping
     // significantly better onto fewer individual concurrent queue dispatchers
     // paired with higher integrated thread limits.
     numInferenceThreads =
         std::max(1u, std::thread::hardware_concurrency() / 10);
-    int intraOpThreads =
+    intraOpThreads =
         std::max(1u, std::thread::hardware_concurrency() / numInferenceThreads);
     int optimalDinoThreads = 5; // Theoretical max bound per worker instance
+    if (tuned) {
+      numInferenceThreads = tuned->workers;
+      intraOpThreads = tuned->intraOpThreads;
+      optimalDinoThreads = tuned->intraOpThreads;
+    }
 
     Metrics::getInstance().setThreadInfo(numInferenceThreads,
                                          std::thread::hardware_concurrency());
 
+    double rss0 = residentMemoryMB();
+    auto t0 = std::chrono::steady_clock::now();
+
     // Instantiate the primary thread worker then copy its properties natively
     auto primary_dino = std::make_unique<GroundingDINO>(
         modelPath, 0.3f, "vocab.txt", 0.25f, intraOpThreads, use_optimization);
@@ -309,6 +1044,8 @@ VideoProcessor::VideoProcessor(const std::map<std::string, std::string> &args)
     primary_dino->get_model_info(backend, precision, t_width, t_height,
                                  optimal);
 
+    if (tuned)
+      optimal = optimalDinoThreads; // measured, not the model's hint
     Metrics::getInstance().setOptimizationInfo(
         backend, precision, t_width, t_height, intraOpThreads, optimal);
 
@@ -319,38 +1056,477 @@ VideoProcessor::VideoProcessor(const std::map<std::string, std::string> &args)
           std::make_unique<GroundingDINO>(modelPath, 0.3f, "vocab.txt", 0.25f,
                                           intraOpThreads, use_optimization));
     }
+    Metrics::getInstance().setSessionInfo(
+        numInferenceThreads, numInferenceThreads,
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0)
+            .count(),
+        residentMemoryMB() - rss0);
+  }
+
+  if (args.find("--redact") != args.end()) {
+    redactMode = parseRedactMode(args.at("--redact"));
+  }
+  if (args.find("--redact-block") != args.end()) {
+    redactBlock = std::max(1, std::stoi(args.at("--redact-block")));
+  }
+
+  // Pre- and post-process threads; the sessions have their own threads.
+  // Letterboxing and mask decoding cost a fraction of a session run.
+  taskThreads = std::max(2, numInferenceThreads / 2);
+  if (args.find("--task-threads") != args.end()) {
+    taskThreads = std::max(1, std::stoi(args.at("--task-threads")));
   }
 }
 
 VideoProcessor::~VideoProcessor() {}
 
+std::unique_ptr<YOLO_Detect>
+VideoProcessor::createYolo(const std::string &modelPath, int numThreads) {
+  std::unique_ptr<YOLO> base_yolo =
+      CreateFactory::instance().create(Backend_Type::ONNXRuntime, yoloTask);
+
+  auto *detect = dynamic_cast<YOLO_Detect *>(base_yolo.get());
+  if (!detect) {
+    throw std::runtime_error("Failed to create YOLO model instance.");
+  }
+  base_yolo.release();
+  std::unique_ptr<YOLO_Detect> yolo_instance(detect);
+
+  yolo_instance->set_num_threads(numThreads);
+  // Redactions are painted from the prototype-resolution masks
+  if (auto *segment = dynamic_cast<YOLO_Segment *>(detect))
+    segment->set_full_masks(false);
+  yolo_instance->set_classes(redactClasses);
+  yolo_instance->set_nms(nmsType, nmsTopK, nmsClassAware);
+  yolo_instance->init(yoloAlgo, CPU, yoloPrecision, modelPath);
+  return yolo_instance;
+}
+
+TuneConfig VideoProcessor::autotune(const std::string &modelPath,
+                                    bool use_optimization) {
+  std::string cachePath = "autotune.cache";
+  if (args.find("--autotune-cache") != args.end()) {
+    cachePath = args.at("--autotune-cache");
+  }
+  AutoTuner tuner(cachePath, AutoTuner::parseObjective(args.at("--autotune")));
+  // Everything that changes what a calibration run measures is part of the
+  // key, so a layout tuned in one mode is not reused in another.
+  auto option = [this](const std::string &name, const std::string &fallback) {
+    return args.count(name) ? args.at(name) : fallback;
+  };
+  std::string settings = "pool=" + std::to_string(sharedPoolThreads) +
+                         ",shared-session=" + option("--shared-session", "0");
+  if (engineType == "yolo") {
+    settings += ",algo=" + std::string(magic_enum::enum_name(yoloAlgo)) +
+                ",precision=" +
+                std::string(magic_enum::enum_name(yoloPrecision)) +
+                ",task=" + std::string(magic_enum::enum_name(yoloTask)) +
+                ",preprocess=" + option("--preprocess", "fused");
+  }
+  std::string key = tuner.cacheKey(modelPath, engineType, settings);
+  if (auto cached = tuner.lookup(key)) {
+    std::cout << "Autotune: cached workers=" << cached->workers
+              << " intra=" << cached->intraOpThreads
+              << " batch=" << cached->batch << std::endl;
+    return *cached;
+  }
+
+  // Synthetic 720p noise: exercises the full pre/infer/post path without
+  // touching the input, at the cost of few detections in post-process.
+  cv::Mat frame(720, 1280, CV_8UC3);
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  AutoTuner::SessionFactory factory;
+  std::vector<int> batches = {1};
+  int maxWorkers = cores;
+  if (engineType == "yolo") {
+    // Probe session: batch sizes are only worth timing on a dynamic batch
+    // dimension, and the input size fixes the pre-scaled frame.
+    std::shared_ptr<YOLO_Detect> probe = createYolo(modelPath, 1);
+    if (probe->supports_batch())
+      batches = {1, 2, 4};
+    maxWorkers = std::max(1, cores / 2);
+
+    // Feed the input the way processConfig will: YUV planes for the fused
+    // pre-process, BGR fitted to the model input for "scaled".
+    std::string preprocess = option("--preprocess", "fused");
+    BatchInput sample;
+    auto planes = std::make_shared<std::vector<cv::Mat>>();
+    if (preprocess == "scaled") {
+      cv::Size input = probe->get_input_size();
+      double scale = std::min(input.width / 1280.0, input.height / 720.0);
+      cv::resize(frame, sample.image,
+                 cv::Size(std::lround(1280 * scale), std::lround(720 * scale)));
+      sample.source_size = frame.size();
+    } else if (preprocess == "bgr") {
+      sample.image = frame;
+    } else {
+      planes->emplace_back(720, 1280, CV_8UC1);
+      planes->emplace_back(360, 640, CV_8UC1);
+      planes->emplace_back(360, 640, CV_8UC1);
+      for (int p = 0; p < 3; ++p) {
+        cv::randu((*planes)[p], cv::Scalar::all(0), cv::Scalar::all(255));
+        sample.yuv.data[p] = (*planes)[p].data;
+        sample.yuv.linesize[p] = static_cast<int>((*planes)[p].step);
+      }
+      sample.yuv.width = 1280;
+      sample.yuv.height = 720;
+    }
+
+    // Shared mode: every worker of one intra-op setting runs the same
+    // session, as the inference threads will. calibrate builds all sessions
+    // of a setting before the next, so one cached session is enough.
+    bool sharedSession = option("--shared-session", "0") == "1";
+    using Cached = std::pair<int, std::shared_ptr<YOLO_Detect>>;
+    auto shared = std::make_shared<Cached>(1, probe);
+    factory = [this, &modelPath, sample, planes, sharedSession,
+               shared](int intra) -> AutoTuner::RunFn {
+      std::shared_ptr<YOLO_Detect> yolo;
+      if (sharedSession && shared->first == intra) {
+        yolo = shared->second;
+      } else {
+        yolo = createYolo(modelPath, intra);
+        *shared = {intra, yolo};
+      }
+      return [yolo, sample, planes](int batch) {
+        std::vector<BatchInput> inputs(batch, sample);
+        yolo->infer_batch(inputs);
+      };
+    };
+  } else {
+    std::string prompt = args.at("--prompt");
+    factory = [&modelPath, use_optimization, frame,
+               prompt](int intra) -> AutoTuner::RunFn {
+      auto dino = std::make_shared<GroundingDINO>(
+          modelPath, 0.3f, "vocab.txt", 0.25f, intra, use_optimization);
+      return [dino, frame, prompt](int batch) {
+        for (int b = 0; b < batch; ++b)
+          dino->detect(frame, prompt);
+      };
+    };
+  }
+
+  // Sessions on the global pool ignore their intra-op thread count, so there
+  // is nothing to sweep.
+  TuneConfig best =
+      tuner.calibrate(factory, batches, maxWorkers, sharedPoolThreads == 0);
+  tuner.store(key, best);
+  return best;
+}
+
 bool VideoProcessor::processConfig(const std::string &initSegmentPath,
                                    const std::string &mediaSegmentPath,
                                    const std::string &outputDir) {
   Metrics::getInstance().startProcessing();
+  bool hasInit = !initSegmentPath.empty() && fs::exists(initSegmentPath) &&
+                 fs::file_size(initSegmentPath) > 0;
+
+  // "memory" (default) hands both segments to libavformat through a custom
+  // AVIOContext; "file" keeps the legacy concatenated temp file.
+  bool fileIngest = args.count("--ingest") && args.at("--ingest") == "file";
   std::string tempInput = "temp_full_input.mp4";
+  std::unique_ptr<VideoDecoder> decoderPtr;
 
-  {
-    std::ofstream outfile(tempInput, std::ios::binary);
+  if (fileIngest) {
+    {
+      std::ofstream outfile(tempInput, std::ios::binary);
+
+      // Check if init segment is valid and non-empty
+      if (hasInit) {
+        std::ifstream initFile(initSegmentPath, std::ios::binary);
+        outfile << initFile.rdbuf();
+      }
 
-    // Check if init segment is valid and non-empty
-    if (!initSegmentPath.empty() && fs::exists(initSegmentPath) &&
-        fs::file_size(initSegmentPath) > 0) {
-      std::ifstream initFile(initSegmentPath, std::ios::binary);
-      outfile << initFile.rdbuf();
+      std::ifstream mediaFile(mediaSegmentPath, std::ios::binary);
+      outfile << mediaFile.rdbuf();
     }
+    decoderPtr = std::make_unique<VideoDecoder>(tempInput);
+  } else {
+    auto stream = std::make_unique<SegmentStream>();
+    std::vector<uint8_t> chunk;
+    if (hasInit) {
+      if (!readFile(initSegmentPath, chunk)) {
+        std::cerr << "Failed to read init segment" << std::endl;
+        return false;
+      }
+      stream->append(std::move(chunk));
+    }
+    if (!readFile(mediaSegmentPath, chunk)) {
+      std::cerr << "Failed to read media segment" << std::endl;
+      return false;
+    }
+    stream->append(std::move(chunk));
+    decoderPtr = std::make_unique<VideoDecoder>(std::move(stream));
+  }
+
+  bool ok = runPipeline(*decoderPtr, outputDir, false);
+  if (fileIngest)
+    fs::remove(tempInput);
+  return ok;
+}
+
+bool VideoProcessor::processStream(const std::string &initSegmentPath,
+                                   const std::string &source,
+                                   const std::string &outputDir) {
+  Metrics::getInstance().startProcessing();
+
+  // The segments are appended to one live in-memory stream, so libavformat
+  // sees a single growing fragmented MP4 and the decoder, the workers and
+  // the DASH muxer stay alive across segments.
+  auto stream = std::make_unique<SegmentStream>();
+  stream->live = true;
+  SegmentStream *feed = stream.get();
+
+  std::vector<uint8_t> chunk;
+  if (!initSegmentPath.empty()) {
+    if (!readFile(initSegmentPath, chunk)) {
+      std::cerr << "Failed to read init segment" << std::endl;
+      return false;
+    }
+    feed->append(std::move(chunk));
+  }
+
+  int idleSeconds = 30;
+  if (args.find("--stream-idle") != args.end()) {
+    idleSeconds = std::stoi(args.at("--stream-idle"));
+  }
+
+  // Shared with the feeder, which may outlive this call: a feeder blocked in
+  // a read from stdin cannot be woken, so it is detached rather than joined
+  // and must not touch the stream once stop is set.
+  struct FeedState {
+    std::mutex mutex;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> finished{false};
+    SegmentStream *feed = nullptr;
+  };
+  auto state = std::make_shared<FeedState>();
+  state->feed = feed;
+
+  std::error_code ec;
+  fs::path initPath =
+      initSegmentPath.empty()
+          ? fs::path()
+          : fs::absolute(initSegmentPath, ec).lexically_normal();
+  std::thread feeder([state, source, idleSeconds, initPath]() {
+    auto appendSegment = [&state](const std::string &path) {
+      std::vector<uint8_t> data;
+      if (!readFile(path, data)) {
+        std::cerr << "Failed to read media segment " << path << std::endl;
+        return;
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->stop)
+        return;
+      state->feed->append(std::move(data));
+      Metrics::getInstance().incrementSegmentsIngested();
+    };
+
+    if (source == "-" || fs::is_regular_file(source)) {
+      // Segment list, one path per line; "-" reads stdin as paths arrive.
+      std::ifstream list;
+      if (source != "-")
+        list.open(source);
+      std::istream &in = source == "-" ? std::cin : list;
+      std::string line;
+      while (!state->stop && std::getline(in, line)) {
+        if (!line.empty())
+          appendSegment(line);
+      }
+    } else {
+      // Watched directory: media segments named <prefix><number>.m4s, taken
+      // strictly in number order ("chunk-10" after "chunk-9") once their size
+      // is stable between polls. The first segment is the lowest-numbered
+      // one present; a later one is never appended before the one it
+      // follows, whichever finishes writing first. A segment that never
+      // shows up (dropped by the encoder, removed by a cleaner) is skipped
+      // once kGapSegments later ones are stable or after kGapWait. Init
+      // segments are skipped.
+      auto parseSegment = [&initPath](const fs::path &path,
+                                      std::string &prefix, int64_t &number) {
+        if (path.extension() != ".m4s")
+          return false;
+        std::error_code ec;
+        if (!initPath.empty() &&
+            fs::absolute(path, ec).lexically_normal() == initPath)
+          return false;
+        std::string stem = path.stem().string();
+        std::string lower = stem;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower.find("init") != std::string::npos)
+          return false;
+        size_t digits = stem.find_last_not_of("0123456789") + 1;
+        if (digits == stem.size())
+          return false;
+        prefix = stem.substr(0, digits);
+        try {
+          number = std::stoll(stem.substr(digits));
+        } catch (const std::out_of_range &) {
+          return false; // more digits than a segment number can have
+        }
+        return true;
+      };
+
+      const int kGapSegments = 3;
+      const auto kGapWait = std::chrono::seconds(5);
+      std::string streamPrefix; // set by the first segment
+      int64_t next = -1;        // number of the next segment to append
+      std::map<int64_t, std::pair<std::string, uintmax_t>> seen;
+      auto lastSegment = std::chrono::steady_clock::now();
+      std::optional<std::chrono::steady_clock::time_point> gapSince;
+      while (!state->stop) {
+        std::error_code ec;
+        std::map<int64_t, std::pair<std::string, uintmax_t>> sizes;
+        for (const auto &entry : fs::directory_iterator(source, ec)) {
+          std::string prefix;
+          int64_t number;
+          if (!parseSegment(entry.path(), prefix, number) ||
+              (!streamPrefix.empty() && prefix != streamPrefix) ||
+              (next >= 0 && number < next))
+            continue;
+          sizes[number] = {entry.path().string(), entry.file_size(ec)};
+          if (streamPrefix.empty())
+            streamPrefix = prefix;
+        }
+        if (next < 0 && !sizes.empty())
+          next = sizes.begin()->first;
+
+        // Append the run of stable segments starting at next.
+        for (auto it = sizes.find(next); it != sizes.end() &&
+                                         it->first == next && !state->stop;
+             ++it) {
+          auto prev = seen.find(next);
+          if (prev == seen.end() || prev->second != it->second ||
+              it->second.second == 0)
+            break;
+          appendSegment(it->second.first);
+          ++next;
+          lastSegment = std::chrono::steady_clock::now();
+          gapSince.reset();
+        }
+
+        // next is missing while later segments are complete: give it a
+        // bounded wait, then resume at the lowest stable one.
+        if (next >= 0 && !state->stop && sizes.count(next) == 0) {
+          int stable = 0;
+          int64_t resume = -1;
+          for (auto it = sizes.upper_bound(next); it != sizes.end(); ++it) {
+            auto prev = seen.find(it->first);
+            if (prev == seen.end() || prev->second != it->second ||
+                it->second.second == 0)
+              continue;
+            if (resume < 0)
+              resume = it->first;
+            ++stable;
+          }
+          auto now = std::chrono::steady_clock::now();
+          if (resume < 0) {
+            gapSince.reset();
+          } else if (!gapSince) {
+            gapSince = now;
+          }
+          if (resume >= 0 &&
+              (stable >= kGapSegments || now - *gapSince >= kGapWait)) {
+            std::cerr << "Segment gap: " << streamPrefix << next;
+            if (resume - 1 > next)
+              std::cerr << " to " << streamPrefix << resume - 1;
+            std::cerr << " never arrived, resuming at " << streamPrefix
+                      << resume << std::endl;
+            next = resume;
+            gapSince.reset();
+          }
+        }
+        seen = std::move(sizes);
+
+        if (idleSeconds > 0 &&
+            std::chrono::steady_clock::now() - lastSegment >
+                std::chrono::seconds(idleSeconds))
+          break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (!state->stop)
+        state->feed->close();
+    }
+    state->finished = true;
+  });
+
+  VideoDecoder decoder(std::move(stream));
+  bool ok = runPipeline(decoder, outputDir, true);
 
-    std::ifstream mediaFile(mediaSegmentPath, std::ios::binary);
-    outfile << mediaFile.rdbuf();
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->stop = true;
+    feed->close();
   }
+  // Blocked on stdin (the pipeline ended first, e.g. open failed or
+  // --checkframes was reached): it can only be left behind.
+  if (source == "-" && !state->finished)
+    feeder.detach();
+  else
+    feeder.join();
+  return ok;
+}
+
+bool VideoProcessor::runPipeline(VideoDecoder &decoder,
+                                 const std::string &outputDir, bool live) {
+  // Decode threads default to the cores inference leaves idle.
+  int decodeThreads = 0;
+  if (args.find("--decode-threads") != args.end()) {
+    decodeThreads = std::stoi(args.at("--decode-threads"));
+  }
+  if (decodeThreads <= 0) {
+    int idleCores = static_cast<int>(std::thread::hardware_concurrency()) -
+                    numInferenceThreads * intraOpThreads;
+    decodeThreads = std::clamp(idleCores, 1, 16);
+  }
+  int decodeThreadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  if (args.find("--decode-thread-type") != args.end()) {
+    const std::string &type = args.at("--decode-thread-type");
+    if (type == "frame")
+      decodeThreadType = FF_THREAD_FRAME;
+    else if (type == "slice")
+      decodeThreadType = FF_THREAD_SLICE;
+  }
+  decoder.setThreading(decodeThreads, decodeThreadType);
+  // Both queues full, one frame per worker and the one being encoded.
+  decoder.setPoolCapacity(decodeQueue.capacity() + inferenceQueue.capacity() +
+                          numInferenceThreads + 1);
+
+  // "fused" (default for YOLO) builds the model input straight from the
+  // decoded YUV planes; "scaled" has swscale convert to BGR at the
+  // letterboxed inference size; "bgr" converts at full resolution.
+  std::string preprocess = "bgr";
+  if (engineType == "yolo") {
+    preprocess = args.count("--preprocess") ? args.at("--preprocess") : "fused";
+    if (preprocess != "scaled" && preprocess != "bgr")
+      preprocess = "fused";
+  }
+  decoder.setConvertToBGR(preprocess != "fused");
+  if (preprocess != "bgr")
+    decoder.setScaleToFit(yoloPool[0]->get_input_size());
 
-  VideoDecoder decoder(tempInput);
   if (!decoder.open()) {
     std::cerr << "Failed to open input video" << std::endl;
     return false;
   }
+  Metrics::getInstance().setDecodeInfo(decoder.getThreadCount(),
+                                       decoder.getThreadType());
+  if (preprocess == "fused" && decoder.getConvertToBGR())
+    std::cerr << "Fused pre-process needs yuv420p input, falling back to "
+                 "scaled BGR"
+              << std::endl;
 
   Metrics::getInstance().setFrameSize(decoder.getWidth(), decoder.getHeight());
+  Metrics::getInstance().setPreprocessInfo(
+      !decoder.getConvertToBGR() ? "fused"
+      : preprocess == "bgr"      ? "bgr"
+                                 : "scaled",
+      decoder.getOutputWidth(), decoder.getOutputHeight());
 
   std::string cleanOutputDir = outputDir;
   if (!cleanOutputDir.empty() && cleanOutputDir.back() == '/') {
@@ -358,6 +1534,7 @@ bool VideoProcessor::processConfig(const std::string &initSegmentPath,
   }
   std::string outputFileName = cleanOutputDir + "/manifest.mpd";
   VideoEncoder encoder(outputFileName, decoder.getStream());
+  encoder.setLive(live);
   if (!encoder.open()) {
     std::cerr << "Failed to open output video" << std::endl;
     return false;
@@ -365,63 +1542,191 @@ bool VideoProcessor::processConfig(const std::string &initSegmentPath,
 
   isDecodingFinished = false;
 
-  std::thread decodeThread([&]() {
-    cv::Mat frame;
-    AVFrame *yuvFrame = nullptr;
-    int64_t pts;
+  // Temporal stride: infer every Nth frame (plus keyframes and scene cuts)
+  // and repaint the last result, optionally motion-shifted, in between.
+  int inferEvery = 1;
+  if (args.find("--infer-every") != args.end()) {
+    inferEvery = std::max(1, std::stoi(args.at("--infer-every")));
+  }
+  bool carryShift = inferEvery > 1 && args.count("--carry-shift") &&
+                    args.at("--carry-shift") == "1";
+
+  // GOP-parallel decoding: number of decoder contexts working on separate
+  // closed GOPs (0 = decode sequentially).
+  int gopDecoders = 0;
+  if (args.find("--gop-parallel") != args.end()) {
+    gopDecoders = std::stoi(args.at("--gop-parallel"));
+  }
+  if (live && gopDecoders > 1) {
+    // The pre-scan needs the whole input up front.
+    std::cerr << "GOP-parallel decoding is not available in streaming mode"
+              << std::endl;
+    gopDecoders = 0;
+  }
 
+  std::thread decodeThread([&]() {
     int checkFramesLimit = -1;
     if (args.find("--checkframes") != args.end()) {
       checkFramesLimit = std::stoi(args.at("--checkframes"));
     }
 
-    int frames_read = 0;
-    while (decoder.readFrame(frame, yuvFrame, pts)) {
-      if (checkFramesLimit > 0 && frames_read >= checkFramesLimit)
-        break; // Dynamically bound benchmarking threshold
-      frames_read++;
+    auto pushFrame = [&](cv::Mat &frame, AVFrame *yuvFrame, int64_t pts,
+                         int64_t seq) {
+      if (checkFramesLimit > 0 && seq >= checkFramesLimit) {
+        // Dynamically bound benchmarking threshold
+        av_frame_free(&yuvFrame);
+        return false;
+      }
       FramePayload payload;
       payload.frameBGR = frame;
       payload.yuvFrame = yuvFrame;
       payload.pts = pts;
-      payload.isValid = true;
-      decodeQueue.push(payload);
+      payload.seq = seq;
+      // A frame lost in GOP-parallel decoding only holds its place in the
+      // output order.
+      payload.isValid = yuvFrame != nullptr;
+      if (!payload.isValid) {
+        payload.infer = false;
+        decodeQueue.push(std::move(payload));
+        return true;
+      }
+      bool cut = inferEvery > 1 && isSceneCut(yuvFrame);
+      payload.infer = inferEvery == 1 || seq % inferEvery == 0 || cut ||
+                      isKeyFrame(yuvFrame);
+      auto tq0 = std::chrono::high_resolution_clock::now();
+      decodeQueue.push(std::move(payload));
+      Metrics::getInstance().addDecodeQueueWait(
+          std::chrono::duration<double, std::milli>(
+              std::chrono::high_resolution_clock::now() - tq0)
+              .count());
+      return true;
+    };
+
+    if (gopDecoders > 1) {
+      int gops = decoder.decodeGopParallel(
+          gopDecoders,
+          [&](cv::Mat &frame, AVFrame *yuvFrame, int64_t pts, int64_t seq) {
+            return pushFrame(frame, yuvFrame, pts, seq);
+          });
+      Metrics::getInstance().setGopInfo(gops, gopDecoders);
+    } else {
+      cv::Mat frame;
+      AVFrame *yuvFrame = nullptr;
+      int64_t pts;
+      int64_t seq = 0;
+      while (decoder.readFrame(frame, yuvFrame, pts)) {
+        if (!pushFrame(frame, yuvFrame, pts, seq++))
+          break;
+      }
     }
     isDecodingFinished = true;
     decodeQueue.close();
   });
 
-  activeInferenceThreads = numInferenceThreads;
-  std::vector<std::thread> inferenceThreads;
-  for (int i = 0; i < numInferenceThreads; ++i) {
-    inferenceThreads.emplace_back([this, i]() {
-      while (true) {
-        auto payloadOpt = decodeQueue.pop();
-        if (!payloadOpt) {
-          if (decodeQueue.is_closed() && decodeQueue.size() == 0)
-            break;
-          continue;
-        }
-        FramePayload payload = *payloadOpt;
-        if (payload.isValid) {
-          if (engineType == "yolo") {
-            processFrame(payload.frameBGR, payload.yuvFrame, yoloPool[i].get());
-          } else if (engineType == "dino") {
-            processFrameDino(payload.frameBGR, payload.yuvFrame,
-                             dinoPool[i].get(), args.at("--prompt"));
+  // Each inferred frame passes three stages. Pre-process (letterbox into the
+  // frame's own input tensor) and post-process (mask decode, redactions,
+  // painting) run as tasks on the work-stealing pool. Inference runs on one
+  // thread per session, fed by readyQueue, so a prepared tensor is waiting
+  // whenever a session frees up. inFlight holds the jobs not in use; their
+  // number caps the frames between the decode queue and the output stage,
+  // and each keeps its context's tensors and outputs from frame to frame.
+  std::thread dispatchThread([this, carryShift]() {
+    // One inference thread per worker; in shared-session mode they all run
+    // on yoloPool[0].
+    size_t sessions = numInferenceThreads;
+    size_t maxInFlight = sessions * batchSize * 2 + taskThreads;
+    MpmcQueue<std::shared_ptr<FrameJob>> readyQueue(maxInFlight);
+    ThreadSafeQueue<std::shared_ptr<FrameJob>> inFlight(maxInFlight);
+    for (size_t i = 0; i < maxInFlight; ++i)
+      inFlight.push(std::make_shared<FrameJob>());
+
+    TaskScheduler scheduler(taskThreads);
+    std::vector<std::thread> sessionThreads;
+    for (size_t s = 0; s < sessions; ++s) {
+      sessionThreads.emplace_back([&, s]() {
+        while (auto first = readyQueue.pop()) {
+          std::vector<std::shared_ptr<FrameJob>> batch;
+          batch.push_back(std::move(*first));
+          if (engineType == "yolo" && batchSize > 1) {
+            // Wait at most batchWaitMs for the batch to fill so a slow
+            // pre-process does not stall the frames already prepared.
+            auto deadline = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(batchWaitMs);
+            while (static_cast<int>(batch.size()) < batchSize) {
+              auto next = readyQueue.pop_until(deadline);
+              if (!next)
+                break;
+              batch.push_back(std::move(*next));
+            }
+          }
+
+          runInference(batch, s);
+          for (auto &job : batch) {
+            scheduler.submit([this, job, carryShift, &inFlight]() {
+              postProcessFrame(*job, carryShift);
+              inferenceQueue.push(std::move(job->payload));
+              job->payload = FramePayload();
+              inFlight.push(job);
+            });
           }
         }
-        inferenceQueue.push(payload);
-      }
-      if (--activeInferenceThreads == 0) {
-        inferenceQueue.close();
+      });
+    }
+
+    while (auto payloadOpt = decodeQueue.pop()) {
+      // Frames with nothing to infer go straight to the output stage.
+      if (!payloadOpt->isValid || !payloadOpt->infer) {
+        inferenceQueue.push(std::move(*payloadOpt));
+        continue;
       }
-    });
-  }
+      std::shared_ptr<FrameJob> job = *inFlight.pop();
+      job->payload = std::move(*payloadOpt);
+      scheduler.submit([this, job, &readyQueue]() {
+        preProcessFrame(*job);
+        readyQueue.push(job);
+      });
+    }
 
-  // Mux / Encode on Main Thread
+    // Every pre-process task has run once the pool is idle here; the
+    // sessions then drain readyQueue and queue the last post-processing.
+    scheduler.wait();
+    readyQueue.close();
+    for (auto &t : sessionThreads)
+      t.join();
+    scheduler.wait();
+    inferenceQueue.close();
+  });
+
+  // Mux / Encode on Main Thread, in decode order (sequence numbers)
   std::map<int64_t, FramePayload> reorderBuffer;
-  int64_t expected_pts = 0;
+  int64_t expected_seq = 0;
+
+  // Frames skipped by --infer-every get the redactions of the last inferred
+  // frame before them, which the in-order output stage always has.
+  std::vector<Redaction> carried;
+  cv::Mat carriedRef;
+  auto writePayload = [&](FramePayload &payload) {
+    if (!payload.isValid)
+      return;
+    if (payload.infer) {
+      carried = payload.redactions;
+      carriedRef = payload.motionRef;
+    } else {
+      if (carryShift && !carriedRef.empty()) {
+        paintRedactions(
+            payload.yuvFrame,
+            shiftRedactions(carried, carriedRef,
+                            motionThumbnail(payload.yuvFrame),
+                            cv::Size(payload.yuvFrame->width,
+                                     payload.yuvFrame->height)),
+            redactMode, redactBlock);
+      } else {
+        paintRedactions(payload.yuvFrame, carried, redactMode, redactBlock);
+      }
+      Metrics::getInstance().incrementFramesCarried();
+    }
+    encoder.writeFrame(payload.yuvFrame, payload.pts);
+  };
 
   while (true) {
     auto payloadOpt = inferenceQueue.pop();
@@ -431,35 +1736,27 @@ bool VideoProcessor::processConfig(const std::string &initSegmentPath,
       }
       continue;
     }
-    FramePayload payload = *payloadOpt;
-    reorderBuffer[payload.pts] = payload;
+    reorderBuffer[payloadOpt->seq] = std::move(*payloadOpt);
 
     // Output all consecutive frames
     while (!reorderBuffer.empty() &&
-           reorderBuffer.begin()->first == expected_pts) {
+           reorderBuffer.begin()->first == expected_seq) {
       auto it = reorderBuffer.begin();
-      if (it->second.isValid) {
-        encoder.writeFrame(it->second.yuvFrame, it->second.pts);
-      }
+      writePayload(it->second);
       reorderBuffer.erase(it);
-      expected_pts++;
+      expected_seq++;
     }
   }
 
   // Flush any remaining frames in buffer just in case
   for (auto &pair : reorderBuffer) {
-    if (pair.second.isValid) {
-      encoder.writeFrame(pair.second.yuvFrame, pair.second.pts);
-    }
+    writePayload(pair.second);
   }
 
   decodeThread.join();
-  for (auto &t : inferenceThreads) {
-    t.join();
-  }
+  dispatchThread.join();
 
   encoder.flush();
-  fs::remove(tempInput);
 
   Metrics::getInstance().stopProcessing();
   Metrics::getInstance().printMetrics();
@@ -467,74 +1764,136 @@ bool VideoProcessor::processConfig(const std::string &initSegmentPath,
   return true;
 }
 
-void VideoProcessor::processFrame(cv::Mat &frame, AVFrame *yuvFrame,
-                                  YOLO_Segment *yolo) {
+// Inference input for a decoded frame: the YUV planes when the decoder left
+// the BGR Mat empty (fused pre-process), else the BGR frame, possibly already
+// scaled down to the model resolution.
+static BatchInput makeBatchInput(const cv::Mat &frame,
+                                 const AVFrame *yuvFrame) {
+  BatchInput input;
+  input.source_size = cv::Size(yuvFrame->width, yuvFrame->height);
+  if (frame.empty()) {
+    for (int i = 0; i < 3; ++i) {
+      input.yuv.data[i] = yuvFrame->data[i];
+      input.yuv.linesize[i] = yuvFrame->linesize[i];
+    }
+    input.yuv.width = yuvFrame->width;
+    input.yuv.height = yuvFrame->height;
+    input.yuv.full_range = yuvFrame->format == AV_PIX_FMT_YUVJ420P ||
+                           yuvFrame->color_range == AVCOL_RANGE_JPEG;
+  } else {
+    input.image = frame;
+  }
+  return input;
+}
+
+void VideoProcessor::preProcessFrame(FrameJob &job) {
+  if (engineType != "yolo")
+    return; // GroundingDINO prepares its input inside detect()
   auto t0 = std::chrono::high_resolution_clock::now();
 
-  yolo->infer_image(frame);
-  const std::vector<OutputSeg> &output = yolo->getOutputSeg();
+  job.context.input =
+      makeBatchInput(job.payload.frameBGR, job.payload.yuvFrame);
+  // Pre- and post-process keep no state in the model object, so any
+  // session's instance serves.
+  yoloPool.front()->pre_process_frame(job.context);
 
-  // Create zero-copy cv::Mat wrapper around the hardware Y-plane (Luminance)
-  cv::Mat y_plane(yuvFrame->height, yuvFrame->width, CV_8UC1, yuvFrame->data[0],
-                  yuvFrame->linesize[0]);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  Metrics::getInstance().addStageTime(
+      Metrics::Stage::Pre,
+      std::chrono::duration<double, std::milli>(t1 - t0).count());
+}
 
-  for (const auto &det : output) {
-    if (det.id == 0) { // Person
-      // intersection with frame
-      cv::Rect bbox = det.box & cv::Rect(0, 0, frame.cols, frame.rows);
-
-      if (bbox.area() > 0 && !det.mask.empty()) {
-        // det.mask corresponds to det.box. We need to crop it to bbox.
-        // The offset is the difference between bbox.tl() and det.box.tl()
-        cv::Rect mask_roi(bbox.x - det.box.x, bbox.y - det.box.y, bbox.width,
-                          bbox.height);
-
-        // Ensure ROI is within mask bounds
-        mask_roi = mask_roi & cv::Rect(0, 0, det.mask.cols, det.mask.rows);
-
-        if (mask_roi.area() > 0 && mask_roi.width == bbox.width &&
-            mask_roi.height == bbox.height) {
-          cv::Mat valid_mask = det.mask(mask_roi).clone();
-          if (!valid_mask.empty() && valid_mask.type() == CV_8UC1) {
-            // Apply mask to BGR frame (optional, for visual debugging)
-            frame(bbox).setTo(cv::Scalar(0, 0, 0), valid_mask);
-            // Apply mask directly to the Zero-Copy YUV hardware frame buffer
-            // Sets luminance to 0 (black in YUV space) where the mask is active
-            y_plane(bbox).setTo(0, valid_mask);
-            std::cout << "Detected obj (person) mask painted\n";
-          }
-        }
-      }
-    }
+void VideoProcessor::runInference(std::vector<std::shared_ptr<FrameJob>> &batch,
+                                  size_t session) {
+  if (engineType == "dino") {
+    for (auto &job : batch)
+      inferDino(job->payload, dinoPool[session].get(), args.at("--prompt"));
+    return;
   }
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  std::vector<SegmentContext *> contexts;
+  for (auto &job : batch)
+    contexts.push_back(&job->context);
+  YOLO_Detect *yolo = yoloPool[session % yoloPool.size()].get();
+  yolo->process_frames(contexts);
+  if (batchSize > 1 && yolo->supports_batch())
+    Metrics::getInstance().addBatch(static_cast<int>(batch.size()));
 
+  // The run is shared, so each frame is charged an equal slice of it.
   auto t1 = std::chrono::high_resolution_clock::now();
   double inf_time = std::chrono::duration<double, std::milli>(t1 - t0).count();
-  Metrics::getInstance().addTimeToInference(inf_time);
+  for (size_t b = 0; b < batch.size(); ++b)
+    Metrics::getInstance().addStageTime(Metrics::Stage::Infer,
+                                        inf_time / batch.size());
+}
+
+void VideoProcessor::postProcessFrame(FrameJob &job, bool carryShift) {
+  if (engineType == "yolo") {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    yoloPool.front()->post_process_frame(job.context);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    Metrics::getInstance().addStageTime(
+        Metrics::Stage::Post,
+        std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  finishFrame(job.payload, job.context.output_seg, carryShift);
+  // The buffers serve the job's next frame; only references into this
+  // frame are dropped.
+  job.context.input = BatchInput();
+  job.context.output_seg.clear();
+}
+
+void VideoProcessor::finishFrame(FramePayload &payload,
+                                 const std::vector<OutputSeg> &output,
+                                 bool carryShift) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  // Before painting: the carry stage matches against unredacted luma.
+  if (carryShift)
+    payload.motionRef = motionThumbnail(payload.yuvFrame);
+  collectRedactions(payload.yuvFrame, output, payload.redactions);
+  paintRedactions(payload.yuvFrame, payload.redactions, redactMode,
+                  redactBlock);
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  double inf_time = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  Metrics::getInstance().addStageTime(Metrics::Stage::Post, inf_time);
   Metrics::getInstance().incrementFramesInferred();
 }
 
-void VideoProcessor::processFrameDino(cv::Mat &frame, AVFrame *yuvFrame,
-                                      GroundingDINO *dino,
-                                      const std::string &prompt) {
+void VideoProcessor::collectRedactions(AVFrame *yuvFrame,
+                                       const std::vector<OutputSeg> &output,
+                                       std::vector<Redaction> &redactions) {
+  // The detector already dropped classes outside redactClasses.
+  for (const auto &det : output) {
+    // intersection with frame
+    cv::Rect bbox = det.box & cv::Rect(0, 0, yuvFrame->width, yuvFrame->height);
+
+    // The mask stays at prototype resolution; paintRedactions upsamples
+    // it inside bbox while writing the planes.
+    if (bbox.area() > 0 && !det.proto_mask.logits.empty())
+      redactions.push_back({bbox, det.proto_mask});
+  }
+}
+
+void VideoProcessor::inferDino(FramePayload &payload, GroundingDINO *dino,
+                               const std::string &prompt) {
   auto t0 = std::chrono::high_resolution_clock::now();
 
+  cv::Mat &frame = payload.frameBGR;
   std::vector<DINOObject> output = dino->detect(frame, prompt);
 
-  cv::Mat y_plane(yuvFrame->height, yuvFrame->width, CV_8UC1, yuvFrame->data[0],
-                  yuvFrame->linesize[0]);
-
   for (const auto &det : output) {
     cv::Rect bbox = det.box & cv::Rect(0, 0, frame.cols, frame.rows);
     if (bbox.area() > 0) {
       // Draw a black bounding box around the detected text prompt objects onto
       // the Y-plane
-      cv::rectangle(y_plane, bbox, cv::Scalar(0), 4);
+      payload.redactions.push_back({bbox, ProtoMask()});
     }
   }
 
   auto t1 = std::chrono::high_resolution_clock::now();
   double inf_time = std::chrono::duration<double, std::milli>(t1 - t0).count();
-  Metrics::getInstance().addTimeToInference(inf_time);
-  Metrics::getInstance().incrementFramesInferred();
+  Metrics::getInstance().addStageTime(Metrics::Stage::Infer, inf_time);
 }
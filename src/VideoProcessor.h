@@ -11,17 +11,40 @@
 #include <opencv2/opencv.hpp>
 
 // YOLO and DINO
+#include "AutoTuner.h"
+#include "MpmcQueue.h"
+#include "RedactKernel.h"
 #include "ThreadSafeQueue.h"
 #include "dino/grounding_dino.h"
 #include "yolo/yolo_segment.h"
 
 struct AVFrame;
+class VideoDecoder;
+
+// Area redacted in the YUV planes: the mask pixels inside box, or the box
+// outline on the Y plane when there is no mask.
+struct Redaction {
+  cv::Rect box;
+  ProtoMask mask; // Prototype resolution, upsampled while painting
+};
 
 struct FramePayload {
   cv::Mat frameBGR;            // For Inference
   AVFrame *yuvFrame = nullptr; // Original decoded frame from demuxer
   int64_t pts;
+  int64_t seq = 0; // Presentation-order index, drives the reorder stage
   bool isValid = true;
+  bool infer = true; // false: repaint the last inferred frame's redactions
+  std::vector<Redaction> redactions; // Inference result, source pixels
+  cv::Mat motionRef; // Downscaled luma before painting, for carry shift
+};
+
+// An inferred frame on its way through the pre-process, inference and
+// post-process stages; context holds the per-frame model state. Jobs are
+// recycled, so the context's tensors are allocated once per job.
+struct FrameJob {
+  FramePayload payload;
+  SegmentContext context;
 };
 
 class VideoProcessor {
@@ -33,23 +56,57 @@ public:
                      const std::string &mediaSegmentPath,
                      const std::string &outputDir);
 
+  // Streaming mode: media segments from a watched directory, a list file or
+  // stdin ("-") are fed through one decoder, worker pool and DASH muxer
+  // that stay alive until the source ends.
+  bool processStream(const std::string &initSegmentPath,
+                     const std::string &source, const std::string &outputDir);
+
 private:
   std::map<std::string, std::string> args;
   int numInferenceThreads;
+  int intraOpThreads = 1;
+  int batchSize = 1;   // YOLO frames per session run
+  int batchWaitMs = 5; // Max wait for a batch to fill
+  int taskThreads = 1; // Scheduler threads running the per-frame stages
+  int sharedPoolThreads = 0; // Global intra-op pool size, 0 = per session
+  RedactMode redactMode = RedactMode::Fill;
+  int redactBlock = 16; // Pixelate block / blur kernel, luma pixels
+  std::vector<int> redactClasses{0}; // YOLO classes to redact, person
+  NMS_Type nmsType = NMS_Type::Fast;
+  int nmsTopK = 0;            // Candidates ranked per frame, 0 = all
+  bool nmsClassAware = false; // Suppress only within a class
+  Algo_Type yoloAlgo = YOLOv8;
+  Model_Type yoloPrecision = FP32; // Weights; INT8 models keep FP32 I/O
+  Task_Type yoloTask = Segment;    // Detect redacts whole boxes
 
   std::string engineType;
-  std::vector<std::unique_ptr<YOLO_Segment>> yoloPool;
+  std::vector<std::unique_ptr<YOLO_Detect>> yoloPool;
   std::vector<std::unique_ptr<GroundingDINO>> dinoPool;
 
   // Queues
-  ThreadSafeQueue<FramePayload> decodeQueue{50};
-  ThreadSafeQueue<FramePayload> inferenceQueue{50};
+  MpmcQueue<FramePayload> decodeQueue{50};
+  MpmcQueue<FramePayload> inferenceQueue{50};
 
   // State
   std::atomic<bool> isDecodingFinished{false};
-  std::atomic<int> activeInferenceThreads{0};
 
-  void processFrame(cv::Mat &frame, AVFrame *yuvFrame, YOLO_Segment *yolo);
-  void processFrameDino(cv::Mat &frame, AVFrame *yuvFrame, GroundingDINO *dino,
-                        const std::string &prompt);
+  std::unique_ptr<YOLO_Detect> createYolo(const std::string &modelPath,
+                                          int numThreads);
+  TuneConfig autotune(const std::string &modelPath, bool use_optimization);
+  bool runPipeline(VideoDecoder &decoder, const std::string &outputDir,
+                   bool live);
+  // Pipeline stages. Pre- and post-process run as scheduler tasks on any
+  // thread; runInference runs on the thread that owns the session.
+  void preProcessFrame(FrameJob &job);
+  void runInference(std::vector<std::shared_ptr<FrameJob>> &batch,
+                    size_t session);
+  void postProcessFrame(FrameJob &job, bool carryShift);
+  void inferDino(FramePayload &payload, GroundingDINO *dino,
+                 const std::string &prompt);
+  void finishFrame(FramePayload &payload, const std::vector<OutputSeg> &output,
+                   bool carryShift);
+  void collectRedactions(AVFrame *yuvFrame,
+                         const std::vector<OutputSeg> &output,
+                         std::vector<Redaction> &redactions);
 };
@@ -8,12 +8,37 @@ using namespace cv;
 using namespace std;
 using namespace Ort;
 
+// One environment per process. With shared resources it owns the intra-op
+// pool every session runs on, so idle sessions no longer keep spinning
+// threads of their own.
+Env &GroundingDINO::env() {
+  static Env env = [] {
+    if (shared_pool_threads <= 0)
+      return Env(ORT_LOGGING_LEVEL_ERROR, "GroundingDINO");
+    ThreadingOptions threading_options;
+    threading_options.SetGlobalIntraOpNumThreads(shared_pool_threads);
+    threading_options.SetGlobalInterOpNumThreads(1);
+    threading_options.SetGlobalSpinControl(0);
+    return Env(threading_options, ORT_LOGGING_LEVEL_ERROR, "GroundingDINO");
+  }();
+  return env;
+}
+
+PrepackedWeightsContainer &GroundingDINO::prepacked_weights() {
+  static PrepackedWeightsContainer container;
+  return container;
+}
+
 GroundingDINO::GroundingDINO(string modelpath, float box_threshold,
                              string vocab_path, float text_threshold,
-                             int num_threads, bool use_optimization)
-    : env(ORT_LOGGING_LEVEL_ERROR, "GroundingDINO") {
-  sessionOptions.SetIntraOpNumThreads(num_threads);
-  sessionOptions.SetInterOpNumThreads(1);
+                             int num_threads, bool use_optimization) {
+  bool shared = shared_pool_threads > 0;
+  if (shared) {
+    sessionOptions.DisablePerSessionThreads();
+  } else {
+    sessionOptions.SetIntraOpNumThreads(num_threads);
+    sessionOptions.SetInterOpNumThreads(1);
+  }
 
   if (use_optimization) {
     sessionOptions.EnableCpuMemArena();
@@ -23,8 +48,14 @@ GroundingDINO::GroundingDINO(string modelpath, float box_threshold,
     sessionOptions.SetGraphOptimizationLevel(ORT_ENABLE_BASIC);
   }
 
+  // Sessions built on one container keep a single copy of each prepacked
+  // weight instead of one per session.
   ort_session =
-      std::make_unique<Ort::Session>(env, modelpath.c_str(), sessionOptions);
+      shared ? std::make_unique<Ort::Session>(env(), modelpath.c_str(),
+                                              sessionOptions,
+                                              prepacked_weights())
+             : std::make_unique<Ort::Session>(env(), modelpath.c_str(),
+                                              sessionOptions);
 
   // Dynamically retrieve input tensor dimensions rather than hardcoding.
   TypeInfo type_info = ort_session->GetInputTypeInfo(0);
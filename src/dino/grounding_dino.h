@@ -25,6 +25,13 @@ public:
   void get_model_info(std::string &backend, std::string &precision, int &width,
                       int &height, int &optimal);
 
+  // Share prepacked weights and one intra-op thread pool among all instances
+  // in the process; must be called before the first instance is built.
+  // 0 keeps per-instance pools and weights.
+  static void set_shared_resources(int pool_threads) {
+    shared_pool_threads = pool_threads;
+  }
+
 private:
   void preprocess(cv::Mat img);
   bool load_tokenizer(std::string vocab_path);
@@ -45,7 +52,10 @@ private:
   std::vector<std::vector<uint8_t>> text_self_attention_masks;
   std::vector<std::vector<int64_t>> position_ids;
 
-  Ort::Env env;
+  static Ort::Env &env();
+  static Ort::PrepackedWeightsContainer &prepacked_weights();
+  static inline int shared_pool_threads = 0;
+
   std::unique_ptr<Ort::Session> ort_session;
   Ort::SessionOptions sessionOptions;
   Ort::MemoryInfo memory_info_handler =
@@ -24,12 +24,17 @@ int main(int argc, char *argv[]) {
   }
 
   // Mandatory fields
-  if (args.find("--media") == args.end() || args.find("--out") == args.end() ||
-      args.find("--model") == args.end()) {
+  bool streaming = args.find("--stream") != args.end();
+  if ((!streaming && args.find("--media") == args.end()) ||
+      args.find("--out") == args.end() || args.find("--model") == args.end()) {
     std::cerr << "Usage: " << argv[0] << "\n"
               << "  --engine <yolo|dino> (default: yolo)\n"
               << "  --init <init_segment> (optional)\n"
               << "  --media <media_segment>\n"
+              << "  --stream <dir|list_file|-> (instead of --media: process "
+                 "segments continuously)\n"
+              << "  --stream-idle <seconds> (default: 30, stop watching a "
+                 "directory after no new segment; 0 = never)\n"
               << "  --out <output_dir>\n"
               << "  --model <path_to_onnx_model>\n"
               << "  --prompt <\"text prompt\"> (required if engine is dino)\n"
@@ -37,6 +42,51 @@ int main(int argc, char *argv[]) {
                  "testing/benchmarking)\n"
               << "  --optimize <1|0> (optional aggressive graph layout "
                  "optimization)\n"
+              << "  --ingest <memory|file> (default: memory, read segments "
+                 "through a custom AVIOContext)\n"
+              << "  --decode-threads <n> (default: 0 = cores left idle by "
+                 "inference workers)\n"
+              << "  --decode-thread-type <auto|frame|slice> (default: auto)\n"
+              << "  --preprocess <fused|scaled|bgr> (default: fused, yolo only)\n"
+              << "  --gop-parallel <n> (default: 0 = off, decode closed GOPs "
+                 "on n decoders)\n"
+              << "  --infer-every <n> (default: 1, infer every nth frame and "
+                 "carry masks forward)\n"
+              << "  --carry-shift <1|0> (default: 0, motion-shift carried "
+                 "masks)\n"
+              << "  --batch <n> (default: 1, yolo frames per inference run; "
+                 "needs a dynamic batch model)\n"
+              << "  --batch-wait-ms <ms> (default: 5, max wait to fill a "
+                 "batch)\n"
+              << "  --shared-session <1|0> (default: 0, yolo workers share one "
+                 "ONNX Runtime session)\n"
+              << "  --shared-resources <1|0> (default: 0, sessions share "
+                 "prepacked weights and one global thread pool)\n"
+              << "  --pool-threads <n> (default: cores left by the inference "
+                 "workers, size of the shared pool)\n"
+              << "  --task-threads <n> (default: max(2, workers/2), threads "
+                 "running per-frame pre- and post-process tasks)\n"
+              << "  --algo <YOLOv5|YOLOv8|...|YOLO26> (default: YOLOv8, yolo "
+                 "model family)\n"
+              << "  --precision <FP32|FP16|INT8> (default: FP32, yolo model "
+                 "weights)\n"
+              << "  --task <segment|detect> (default: segment, detect redacts "
+                 "whole boxes)\n"
+              << "  --classes <id,id,...> (default: 0 = person, yolo classes "
+                 "to detect and redact)\n"
+              << "  --nms <fast|reference> (default: fast, yolo NMS "
+                 "implementation)\n"
+              << "  --nms-topk <n> (default: 0 = all, candidates kept before "
+                 "fast NMS)\n"
+              << "  --nms-class-aware <1|0> (default: 0, suppress only "
+                 "within a class)\n"
+              << "  --redact <fill|pixelate|blur> (default: fill, how masked "
+                 "pixels are replaced)\n"
+              << "  --redact-block <n> (default: 16, pixelate block / blur "
+                 "kernel size in pixels)\n"
+              << "  --autotune <throughput|latency|0> (default: 0, calibrate "
+                 "workers x IntraOp threads x batch at startup)\n"
+              << "  --autotune-cache <path> (default: autotune.cache)\n"
               << std::endl;
     return 1;
   }
@@ -62,7 +112,10 @@ int main(int argc, char *argv[]) {
 
   try {
     VideoProcessor vp(args);
-    if (vp.processConfig(initPath, mediaPath, outputDir)) {
+    bool ok = streaming
+                  ? vp.processStream(initPath, args["--stream"], outputDir)
+                  : vp.processConfig(initPath, mediaPath, outputDir);
+    if (ok) {
       std::cout << "Processing completed successfully." << std::endl;
       return 0;
     } else {
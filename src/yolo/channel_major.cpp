@@ -0,0 +1,123 @@
+/*
+ * @Description: kernels for channel-major ([channels x anchors]) YOLO outputs
+ */
+
+#include "channel_major.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CHANNEL_MAJOR_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CHANNEL_MAJOR_NEON 1
+#endif
+
+namespace {
+
+// rows[0..count) are the scanned row indices, in the order ties prefer.
+void argmax_scalar(const float *data, const int *rows, int count, int cols,
+                   float *max, int *argmax, int begin) {
+  const float *first = data + size_t(rows[0]) * cols;
+  for (int x = begin; x < cols; ++x) {
+    max[x] = first[x];
+    argmax[x] = rows[0];
+  }
+  for (int k = 1; k < count; ++k) {
+    const float *row = data + size_t(rows[k]) * cols;
+    for (int x = begin; x < cols; ++x) {
+      if (row[x] > max[x]) {
+        max[x] = row[x];
+        argmax[x] = rows[k];
+      }
+    }
+  }
+}
+
+#ifdef CHANNEL_MAJOR_AVX2
+bool cpu_has_avx2() {
+  static const bool has = __builtin_cpu_supports("avx2");
+  return has;
+}
+
+// Eight columns at a time, all rows streamed in order; the running max and
+// argmax stay in registers. Returns the first column left for the scalar
+// tail.
+__attribute__((target("avx2"))) int argmax_avx2(const float *data,
+                                                const int *rows, int count,
+                                                int cols, float *max,
+                                                int *argmax) {
+  int x = 0;
+  for (; x + 8 <= cols; x += 8) {
+    __m256 best = _mm256_loadu_ps(data + size_t(rows[0]) * cols + x);
+    __m256i best_row = _mm256_set1_epi32(rows[0]);
+    for (int k = 1; k < count; ++k) {
+      __m256 v = _mm256_loadu_ps(data + size_t(rows[k]) * cols + x);
+      __m256 higher = _mm256_cmp_ps(v, best, _CMP_GT_OQ);
+      best = _mm256_blendv_ps(best, v, higher);
+      best_row = _mm256_blendv_epi8(best_row, _mm256_set1_epi32(rows[k]),
+                                    _mm256_castps_si256(higher));
+    }
+    _mm256_storeu_ps(max + x, best);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(argmax + x), best_row);
+  }
+  return x;
+}
+#endif // CHANNEL_MAJOR_AVX2
+
+#ifdef CHANNEL_MAJOR_NEON
+int argmax_neon(const float *data, const int *rows, int count, int cols,
+                float *max, int *argmax) {
+  int x = 0;
+  for (; x + 4 <= cols; x += 4) {
+    float32x4_t best = vld1q_f32(data + size_t(rows[0]) * cols + x);
+    int32x4_t best_row = vdupq_n_s32(rows[0]);
+    for (int k = 1; k < count; ++k) {
+      float32x4_t v = vld1q_f32(data + size_t(rows[k]) * cols + x);
+      uint32x4_t higher = vcgtq_f32(v, best);
+      best = vbslq_f32(higher, v, best);
+      best_row = vbslq_s32(higher, vdupq_n_s32(rows[k]), best_row);
+    }
+    vst1q_f32(max + x, best);
+    vst1q_s32(argmax + x, best_row);
+  }
+  return x;
+}
+#endif // CHANNEL_MAJOR_NEON
+
+} // namespace
+
+void column_argmax(const float *data, int rows, int cols, float *max,
+                   int *argmax) {
+  thread_local std::vector<int> all;
+  if (int(all.size()) < rows) {
+    all.resize(rows);
+    for (int r = 0; r < rows; ++r)
+      all[r] = r;
+  }
+  column_argmax(data, all.data(), rows, cols, max, argmax);
+}
+
+void column_argmax(const float *data, const int *rows, int count, int cols,
+                   float *max, int *argmax) {
+  int x = 0;
+#ifdef CHANNEL_MAJOR_AVX2
+  if (cpu_has_avx2())
+    x = argmax_avx2(data, rows, count, cols, max, argmax);
+#endif
+#ifdef CHANNEL_MAJOR_NEON
+  x = argmax_neon(data, rows, count, cols, max, argmax);
+#endif
+  argmax_scalar(data, rows, count, cols, max, argmax, x);
+}
+
+void select_columns(const float *values, int cols, float threshold,
+                    std::vector<int> &selected) {
+  selected.clear();
+  for (int x = 0; x < cols; ++x) {
+    if (values[x] >= threshold)
+      selected.push_back(x);
+  }
+}
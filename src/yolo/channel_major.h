@@ -0,0 +1,49 @@
+/*
+ * @Description: kernels for channel-major ([channels x anchors]) YOLO outputs
+ */
+
+#pragma once
+
+#include <vector>
+
+/**
+ * @description:             per-column max and argmax over a row-major
+ *                           [rows x cols] block, e.g. the class score rows of
+ *                           a channel-major output. Ties keep the lower row,
+ *                           like std::max_element. Uses AVX2 or NEON when
+ *                           available.
+ * @param {float*} data      first row of the block
+ * @param {int} rows         number of rows, at least 1
+ * @param {int} cols         number of columns, also the row stride
+ * @param {float*} max       output, cols floats
+ * @param {int*} argmax      output, cols row indices
+ * @return {*}
+ */
+void column_argmax(const float *data, int rows, int cols, float *max,
+                   int *argmax);
+
+/**
+ * @description:             column_argmax over selected rows of a row-major
+ *                           block only, e.g. an allow-list of classes
+ * @param {float*} data      first row of the block
+ * @param {int*} rows        indices of the rows to scan, at least one
+ * @param {int} count        number of row indices
+ * @param {int} cols         number of columns, also the row stride
+ * @param {float*} max       output, cols floats
+ * @param {int*} argmax      output, cols row indices taken from rows
+ * @return {*}
+ */
+void column_argmax(const float *data, const int *rows, int count, int cols,
+                   float *max, int *argmax);
+
+/**
+ * @description:             indices of the columns whose value is not below
+ *                           threshold
+ * @param {float*} values    per-column values, e.g. from column_argmax
+ * @param {int} cols         number of columns
+ * @param {float} threshold  lowest value kept
+ * @param {vector<int>&} selected   output, ascending column indices
+ * @return {*}
+ */
+void select_columns(const float *values, int cols, float threshold,
+                    std::vector<int> &selected);
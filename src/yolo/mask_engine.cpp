@@ -0,0 +1,126 @@
+/*
+ * @Description: batched mask assembly for YOLO segmentation
+ */
+
+#include "mask_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/**
+ * @description: region of a box on the prototype grid, as in GetMask
+ */
+struct ProtoRoi {
+  int x, y, w, h;
+};
+
+ProtoRoi proto_roi(const cv::Rect &box, const MaskParams &mask_params) {
+  const int seg_width = mask_params.seg_width;
+  const int seg_height = mask_params.seg_height;
+  const cv::Vec4f params = mask_params.params;
+
+  ProtoRoi roi;
+  roi.x = floor((box.x * params[0] + params[2]) / mask_params.net_width *
+                seg_width);
+  roi.y = floor((box.y * params[1] + params[3]) / mask_params.net_height *
+                seg_height);
+  roi.w = ceil(((box.x + box.width) * params[0] + params[2]) /
+               mask_params.net_width * seg_width) -
+          roi.x;
+  roi.h = ceil(((box.y + box.height) * params[1] + params[3]) /
+               mask_params.net_height * seg_height) -
+          roi.y;
+
+  // clamped to the grid, keeping at least one cell
+  roi.x = std::min(std::max(roi.x, 0), seg_width - 1);
+  roi.y = std::min(std::max(roi.y, 0), seg_height - 1);
+  roi.w = std::min(std::max(roi.w, 1), seg_width - roi.x);
+  roi.h = std::min(std::max(roi.h, 1), seg_height - roi.y);
+  return roi;
+}
+
+} // namespace
+
+void assemble_masks(const float *protos, const cv::Mat &coeffs,
+                    const MaskParams &mask_params, bool logits,
+                    std::vector<OutputSeg> &outputs) {
+  const int count = coeffs.rows;
+  if (count == 0)
+    return;
+
+  const int seg_width = mask_params.seg_width;
+  const int seg_height = mask_params.seg_height;
+  const int net_width = mask_params.net_width;
+  const int net_height = mask_params.net_height;
+  const cv::Vec4f params = mask_params.params;
+
+  std::vector<ProtoRoi> rois(count);
+  int band_top = seg_height, band_bottom = 0;
+  for (int k = 0; k < count; ++k) {
+    rois[k] = proto_roi(outputs[k].box, mask_params);
+    band_top = std::min(band_top, rois[k].y);
+    band_bottom = std::max(band_bottom, rois[k].y + rois[k].h);
+  }
+
+  // Rows band_top..band_bottom of every prototype channel are contiguous, so
+  // the union band is a strided view of the prototype tensor: no copy.
+  const int band = (band_bottom - band_top) * seg_width;
+  cv::Mat protos_band(mask_params.seg_channels, band, CV_32F,
+                      const_cast<float *>(protos) + band_top * seg_width,
+                      sizeof(float) * seg_width * seg_height);
+  thread_local cv::Mat features;
+  cv::gemm(coeffs, protos_band, 1.0, cv::noArray(), 0.0, features);
+
+  // sigmoid(x) > t  <=>  x > log(t / (1 - t)), so logits need no exp
+  float cut = mask_params.mask_threshold;
+  if (logits) {
+    if (cut <= 0.f)
+      cut = -std::numeric_limits<float>::infinity();
+    else if (cut >= 1.f)
+      cut = std::numeric_limits<float>::infinity();
+    else
+      cut = std::log(cut / (1.f - cut));
+  }
+
+  cv::Mat binary, upsampled;
+  for (int k = 0; k < count; ++k) {
+    const ProtoRoi &roi = rois[k];
+    cv::Mat feature(band_bottom - band_top, seg_width, CV_32F,
+                    features.ptr<float>(k));
+    cv::Mat region = feature(cv::Rect(roi.x, roi.y - band_top, roi.w, roi.h));
+
+    // Image area the region upsamples to, as in GetMask
+    int left = floor((net_width / seg_width * roi.x - params[2]) / params[0]);
+    int top = floor((net_height / seg_height * roi.y - params[3]) / params[1]);
+    int width = std::max(1, int(ceil(net_width / seg_width * roi.w / params[0])));
+    int height =
+        std::max(1, int(ceil(net_height / seg_height * roi.h / params[1])));
+
+    // Same sample positions as cv::resize with INTER_LINEAR
+    ProtoMask &proto_mask = outputs[k].proto_mask;
+    proto_mask.logits = region.clone();
+    proto_mask.cut = cut;
+    proto_mask.scale = cv::Point2f(float(roi.w) / width, float(roi.h) / height);
+    proto_mask.offset =
+        cv::Point2f((0.5f - left) * proto_mask.scale.x - 0.5f,
+                    (0.5f - top) * proto_mask.scale.y - 0.5f);
+
+    if (!mask_params.full_masks) {
+      outputs[k].mask = cv::Mat();
+      continue;
+    }
+
+    cv::compare(region, cut, binary, cv::CMP_GT);
+    cv::resize(binary, upsampled, cv::Size(width, height), 0, 0,
+               cv::INTER_LINEAR);
+
+    cv::Rect crop_rect = (outputs[k].box - cv::Point(left, top)) &
+                         cv::Rect(0, 0, upsampled.cols, upsampled.rows);
+    if (crop_rect.area() > 0)
+      outputs[k].mask = upsampled(crop_rect) > 127;
+    else
+      outputs[k].mask = cv::Mat();
+  }
+}
@@ -0,0 +1,32 @@
+/*
+ * @Description: batched mask assembly for YOLO segmentation
+ */
+
+#pragma once
+
+#include "yolo_segment.h"
+
+/**
+ * @description:                 masks of all detections of a frame with one
+ *                               GEMM. The coefficients are multiplied against
+ *                               the rows of the prototype tensor covered by
+ *                               the union of the detections' regions, read in
+ *                               place. Each mask is thresholded at prototype
+ *                               resolution and only the binary mask is
+ *                               upsampled and cropped to its box, unless
+ *                               full masks are off. Every detection also gets
+ *                               its prototype-resolution ProtoMask. Same
+ *                               regions and geometry as YOLO_Segment::GetMask
+ * @param {float*} protos        mask prototypes, [seg_channels x seg_height x
+ *                               seg_width]
+ * @param {Mat&} coeffs          mask coefficients, [K x seg_channels] CV_32F,
+ *                               row k belongs to outputs[k]
+ * @param {MaskParams&} mask_params  mask parameters, letterbox params set
+ * @param {bool} logits          whether coefficients x prototypes are logits
+ *                               whose sigmoid is thresholded (YOLOv5)
+ * @param {vector<OutputSeg>&} outputs   K detections, boxes set, masks filled
+ * @return {*}
+ */
+void assemble_masks(const float *protos, const cv::Mat &coeffs,
+                    const MaskParams &mask_params, bool logits,
+                    std::vector<OutputSeg> &outputs);
@@ -0,0 +1,238 @@
+/*
+ * @Description: fast non-maximum suppression for YOLO detections
+ */
+
+#include "nms_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NMS_ENGINE_X86 1
+#endif
+
+namespace {
+
+/**
+ * @description: candidates in structure-of-arrays form, one entry per
+ *               position; area is computed before any class offset
+ */
+struct BoxSoA {
+  std::vector<float> x1, y1, x2, y2, area;
+
+  void resize(size_t n) {
+    x1.resize(n);
+    y1.resize(n);
+    x2.resize(n);
+    y2.resize(n);
+    area.resize(n);
+  }
+};
+
+// flags[k] |= IoU(box i, box k) >= threshold for k in [begin, end), from
+// `begin` on; the SIMD versions return where they stopped.
+void suppress_scalar(const BoxSoA &s, int i, int begin, int end,
+                     float threshold, uint8_t *flags) {
+  const float x1 = s.x1[i], y1 = s.y1[i], x2 = s.x2[i], y2 = s.y2[i];
+  const float area = s.area[i];
+  for (int k = begin; k < end; ++k) {
+    float w = std::max(0.0f, std::min(x2, s.x2[k]) - std::max(x1, s.x1[k]));
+    float h = std::max(0.0f, std::min(y2, s.y2[k]) - std::max(y1, s.y1[k]));
+    float inter = w * h;
+    if (inter / (area + s.area[k] - inter) >= threshold)
+      flags[k] = 1;
+  }
+}
+
+#ifdef NMS_ENGINE_X86
+bool cpu_has_avx2() {
+  static const bool has = __builtin_cpu_supports("avx2");
+  return has;
+}
+
+bool cpu_has_avx512() {
+  static const bool has = __builtin_cpu_supports("avx512f");
+  return has;
+}
+
+__attribute__((target("avx2"))) int
+suppress_avx2(const BoxSoA &s, int i, int begin, int end, float threshold,
+              uint8_t *flags) {
+  const __m256 x1 = _mm256_set1_ps(s.x1[i]), y1 = _mm256_set1_ps(s.y1[i]);
+  const __m256 x2 = _mm256_set1_ps(s.x2[i]), y2 = _mm256_set1_ps(s.y2[i]);
+  const __m256 area = _mm256_set1_ps(s.area[i]);
+  const __m256 thr = _mm256_set1_ps(threshold);
+  const __m256 zero = _mm256_setzero_ps();
+  int k = begin;
+  for (; k + 8 <= end; k += 8) {
+    __m256 w = _mm256_sub_ps(_mm256_min_ps(x2, _mm256_loadu_ps(&s.x2[k])),
+                             _mm256_max_ps(x1, _mm256_loadu_ps(&s.x1[k])));
+    __m256 h = _mm256_sub_ps(_mm256_min_ps(y2, _mm256_loadu_ps(&s.y2[k])),
+                             _mm256_max_ps(y1, _mm256_loadu_ps(&s.y1[k])));
+    __m256 inter = _mm256_mul_ps(_mm256_max_ps(w, zero),
+                                 _mm256_max_ps(h, zero));
+    __m256 uni = _mm256_sub_ps(
+        _mm256_add_ps(area, _mm256_loadu_ps(&s.area[k])), inter);
+    int hits = _mm256_movemask_ps(
+        _mm256_cmp_ps(_mm256_div_ps(inter, uni), thr, _CMP_GE_OQ));
+    while (hits) {
+      flags[k + __builtin_ctz(hits)] = 1;
+      hits &= hits - 1;
+    }
+  }
+  return k;
+}
+
+__attribute__((target("avx512f"))) int
+suppress_avx512(const BoxSoA &s, int i, int begin, int end, float threshold,
+                uint8_t *flags) {
+  const __m512 x1 = _mm512_set1_ps(s.x1[i]), y1 = _mm512_set1_ps(s.y1[i]);
+  const __m512 x2 = _mm512_set1_ps(s.x2[i]), y2 = _mm512_set1_ps(s.y2[i]);
+  const __m512 area = _mm512_set1_ps(s.area[i]);
+  const __m512 thr = _mm512_set1_ps(threshold);
+  const __m512 zero = _mm512_setzero_ps();
+  int k = begin;
+  for (; k + 16 <= end; k += 16) {
+    __m512 w = _mm512_sub_ps(_mm512_min_ps(x2, _mm512_loadu_ps(&s.x2[k])),
+                             _mm512_max_ps(x1, _mm512_loadu_ps(&s.x1[k])));
+    __m512 h = _mm512_sub_ps(_mm512_min_ps(y2, _mm512_loadu_ps(&s.y2[k])),
+                             _mm512_max_ps(y1, _mm512_loadu_ps(&s.y1[k])));
+    __m512 inter = _mm512_mul_ps(_mm512_max_ps(w, zero),
+                                 _mm512_max_ps(h, zero));
+    __m512 uni = _mm512_sub_ps(
+        _mm512_add_ps(area, _mm512_loadu_ps(&s.area[k])), inter);
+    unsigned hits = _mm512_cmp_ps_mask(_mm512_div_ps(inter, uni), thr,
+                                       _CMP_GE_OQ);
+    while (hits) {
+      flags[k + __builtin_ctz(hits)] = 1;
+      hits &= hits - 1;
+    }
+  }
+  return k;
+}
+#endif
+
+void suppress(const BoxSoA &s, int i, int begin, int end, float threshold,
+              uint8_t *flags) {
+  int k = begin;
+#ifdef NMS_ENGINE_X86
+  if (cpu_has_avx512())
+    k = suppress_avx512(s, i, k, end, threshold, flags);
+  if (cpu_has_avx2())
+    k = suppress_avx2(s, i, k, end, threshold, flags);
+#endif
+  suppress_scalar(s, i, k, end, threshold, flags);
+}
+
+} // namespace
+
+void nms_fast(const std::vector<cv::Rect> &boxes,
+              const std::vector<float> &scores, const int *class_ids,
+              const NMSParams &params, std::vector<int> &indices) {
+  thread_local std::vector<int> order;
+  order.clear();
+  for (int i = 0; i < int(scores.size()); ++i) {
+    if (scores[i] > params.score_threshold)
+      order.push_back(i);
+  }
+  if (order.empty())
+    return;
+
+  // Rank by descending score; ties keep the input order. Past top_k only
+  // the best top_k are sorted at all.
+  auto better = [&scores](int a, int b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  };
+  if (params.top_k > 0 && int(order.size()) > params.top_k) {
+    std::nth_element(order.begin(), order.begin() + params.top_k, order.end(),
+                     better);
+    order.resize(params.top_k);
+  }
+  std::sort(order.begin(), order.end(), better);
+  const int n = int(order.size());
+
+  // Extent of the candidates, for the class offset and the grid.
+  int min_x = boxes[order[0]].x, min_y = boxes[order[0]].y;
+  int max_coord = 0, max_side = 1;
+  for (int id : order) {
+    const cv::Rect &b = boxes[id];
+    min_x = std::min(min_x, b.x);
+    min_y = std::min(min_y, b.y);
+    max_coord = std::max({max_coord, b.x + b.width, b.y + b.height});
+    max_side = std::max({max_side, b.width, b.height});
+  }
+  const int span = max_coord - std::min(min_x, min_y) + 1;
+  const bool offset = params.class_aware && class_ids;
+
+  // Grid cells are as large as the largest box, so boxes that overlap at all
+  // have their top-left corners in the same or adjacent cells. Not worth it
+  // for small sets or a grid of fewer than 3x3 cells.
+  int grid_w = (max_coord - min_x) / max_side + 1;
+  int grid_h = (max_coord - min_y) / max_side + 1;
+  const bool grid = params.grid && params.iou_threshold > 0 && n >= 64 &&
+                    grid_w >= 3 && grid_h >= 3 &&
+                    size_t(grid_w) * grid_h <= size_t(4) * n;
+
+  // position_of[rank]: where the rank-th box lives in the SoA. Without the
+  // grid positions are ranks; with it boxes are grouped by cell, each cell
+  // holding its boxes in rank order.
+  thread_local std::vector<int> position_of, cell_of, cell_start;
+  position_of.resize(n);
+  if (grid) {
+    cell_of.resize(n);
+    cell_start.assign(size_t(grid_w) * grid_h + 1, 0);
+    for (int r = 0; r < n; ++r) {
+      const cv::Rect &b = boxes[order[r]];
+      cell_of[r] = (b.y - min_y) / max_side * grid_w + (b.x - min_x) / max_side;
+      cell_start[cell_of[r] + 1]++;
+    }
+    for (size_t c = 1; c < cell_start.size(); ++c)
+      cell_start[c] += cell_start[c - 1];
+    thread_local std::vector<int> fill;
+    fill.assign(cell_start.begin(), cell_start.end() - 1);
+    for (int r = 0; r < n; ++r)
+      position_of[r] = fill[cell_of[r]]++;
+  } else {
+    for (int r = 0; r < n; ++r)
+      position_of[r] = r;
+  }
+
+  thread_local BoxSoA soa;
+  soa.resize(n);
+  for (int r = 0; r < n; ++r) {
+    const cv::Rect &b = boxes[order[r]];
+    float shift = offset ? float(class_ids[order[r]]) * span : 0.0f;
+    int p = position_of[r];
+    soa.x1[p] = b.x + shift;
+    soa.y1[p] = b.y + shift;
+    soa.x2[p] = b.x + b.width + shift;
+    soa.y2[p] = b.y + b.height + shift;
+    soa.area[p] = float(b.width * b.height);
+  }
+
+  // A kept box flags every box it overlaps enough. IoU is symmetric, so the
+  // earlier boxes it may flag as well are either already suppressed or
+  // already kept, and flagging them changes nothing.
+  thread_local std::vector<uint8_t> suppressed;
+  suppressed.assign(n, 0);
+  const float threshold = params.iou_threshold;
+  for (int r = 0; r < n; ++r) {
+    int p = position_of[r];
+    if (suppressed[p])
+      continue;
+    indices.push_back(order[r]);
+    if (!grid) {
+      suppress(soa, p, r + 1, n, threshold, suppressed.data());
+      continue;
+    }
+    int cx = cell_of[r] % grid_w, cy = cell_of[r] / grid_w;
+    for (int y = std::max(0, cy - 1); y <= std::min(grid_h - 1, cy + 1); ++y) {
+      // The cells of one grid row are contiguous, so each row is one range.
+      int first = y * grid_w + std::max(0, cx - 1);
+      int last = y * grid_w + std::min(grid_w - 1, cx + 1);
+      suppress(soa, p, cell_start[first], cell_start[last + 1], threshold,
+               suppressed.data());
+    }
+  }
+}
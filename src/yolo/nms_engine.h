@@ -0,0 +1,53 @@
+/*
+ * @Description: fast non-maximum suppression for YOLO detections
+ */
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @description: NMS implementation used by YOLO_Detect::nms
+ */
+enum class NMS_Type {
+  Reference, // scalar O(N^2) over every candidate pair
+  Fast,      // nms_fast
+};
+
+/**
+ * @description: nms_fast settings
+ */
+struct NMSParams {
+  float score_threshold = 0.2;  // candidates must score above this
+  float iou_threshold = 0.5;    // suppress at IoU >= this
+  int top_k = 0;                // keep only the best top_k candidates, 0 = all
+  bool class_aware = false;     // suppress only within a class
+  bool grid = true;             // compare only boxes in neighbouring cells
+};
+
+/**
+ * @description:                   greedy NMS with the same result as the
+ *                                 reference implementation. Candidates are
+ *                                 ranked with a partial sort capped at
+ *                                 top_k and laid out as separate x1, y1,
+ *                                 x2, y2 and area arrays, so the IoU of one
+ *                                 kept box against the rest is computed 16
+ *                                 (AVX-512) or 8 (AVX2) boxes at a time.
+ *                                 Class-aware NMS runs as one batch by
+ *                                 offsetting every class into its own
+ *                                 coordinate range. With grid on, boxes are
+ *                                 binned on cells as large as the largest
+ *                                 box, and a kept box is only compared with
+ *                                 the 3x3 cells around it
+ * @param {vector<cv::Rect>&} boxes    detect bounding boxes
+ * @param {vector<float>&} scores      detect scores
+ * @param {int*} class_ids             class of every box, may be null unless
+ *                                     class_aware is set
+ * @param {NMSParams&} params          thresholds and options
+ * @param {vector<int>&} indices       output indices, by descending score
+ * @return {*}
+ */
+void nms_fast(const std::vector<cv::Rect> &boxes,
+              const std::vector<float> &scores, const int *class_ids,
+              const NMSParams &params, std::vector<int> &indices);
@@ -6,17 +6,46 @@
  */
 
 #include "yolo_onnxruntime.h"
+#include <atomic>
+#include <cstring>
+#include <numeric>
 #include <thread>
 
+Ort::Env &YOLO_ONNXRuntime::env() {
+  // The global thread pool is fixed when the environment is created, so the
+  // first session decides whether there is one.
+  static Ort::Env env = [] {
+    if (s_shared_pool_threads <= 0)
+      return Ort::Env();
+    Ort::ThreadingOptions threading_options;
+    threading_options.SetGlobalIntraOpNumThreads(s_shared_pool_threads);
+    threading_options.SetGlobalInterOpNumThreads(1);
+    threading_options.SetGlobalSpinControl(0);
+    return Ort::Env(threading_options, ORT_LOGGING_LEVEL_WARNING, "yolo");
+  }();
+  return env;
+}
+
+Ort::PrepackedWeightsContainer &YOLO_ONNXRuntime::prepacked_weights() {
+  static Ort::PrepackedWeightsContainer container;
+  return container;
+}
+
 void YOLO_ONNXRuntime::init(const Algo_Type algo_type,
                             const Device_Type device_type,
                             const Model_Type model_type,
                             const std::string model_path) {
   m_algo_type = algo_type;
 
+  bool shared = s_shared_pool_threads > 0;
+
   Ort::SessionOptions session_options;
-  session_options.SetIntraOpNumThreads(1);
-  session_options.SetInterOpNumThreads(1);
+  if (shared) {
+    session_options.DisablePerSessionThreads();
+  } else {
+    session_options.SetIntraOpNumThreads(m_num_threads);
+    session_options.SetInterOpNumThreads(1);
+  }
   session_options.SetGraphOptimizationLevel(
       GraphOptimizationLevel::ORT_ENABLE_ALL);
 
@@ -38,24 +67,117 @@ void YOLO_ONNXRuntime::init(const Algo_Type algo_type,
   }
 
 #ifdef _WIN32
-  m_session = new Ort::Session(
-      m_env, std::wstring(model_path.begin(), model_path.end()).c_str(),
-      session_options);
+  std::wstring session_path(model_path.begin(), model_path.end());
 #endif
 
 #ifdef __linux__
-  m_session = new Ort::Session(m_env, model_path.c_str(), session_options);
+  std::string session_path = model_path;
 #endif
+  m_session = shared ? new Ort::Session(env(), session_path.c_str(),
+                                        session_options, prepacked_weights())
+                     : new Ort::Session(env(), session_path.c_str(),
+                                        session_options);
   if (m_session == nullptr) {
     std::cerr << "onnxruntime session create failed!" << std::endl;
     std::exit(-1);
   }
+  static std::atomic<uint64_t> next_session_id{1};
+  m_session_id = next_session_id++;
 
   m_input_names.push_back("images");
   m_output_names.push_back("output0");
+
+  std::vector<int64_t> input_shape =
+      m_session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+  m_dynamic_batch = !input_shape.empty() && input_shape[0] < 0;
+
+  m_output_shapes.clear();
+  m_static_outputs = true;
+  for (size_t i = 0; i < m_session->GetOutputCount(); ++i) {
+    std::vector<int64_t> shape =
+        m_session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+    for (size_t d = 1; d < shape.size(); ++d)
+      m_static_outputs = m_static_outputs && shape[d] > 0;
+    m_output_shapes.push_back(shape);
+  }
+}
+
+Ort::Value YOLO_ONNXRuntime::make_tensor(void *data,
+                                         const std::vector<int64_t> &shape) const {
+  size_t count = std::accumulate(shape.begin(), shape.end(), int64_t(1),
+                                 std::multiplies<int64_t>());
+  if (m_model_type == FP16)
+    return Ort::Value::CreateTensor(m_memory_info, data,
+                                    sizeof(uint16_t) * count, shape.data(),
+                                    shape.size(),
+                                    ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
+  return Ort::Value::CreateTensor(m_memory_info, data, sizeof(float) * count,
+                                  shape.data(), shape.size(),
+                                  ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+}
+
+void YOLO_ONNXRuntime::bind_io(Ort::IoBinding &binding, void *input,
+                               const std::vector<void *> &outputs,
+                               int64_t batch) const {
+  binding.BindInput(m_input_names[0],
+                    make_tensor(input, {batch, 3, m_input_size.width,
+                                        m_input_size.height}));
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (m_static_outputs) {
+      std::vector<int64_t> shape = m_output_shapes[i];
+      shape[0] = batch;
+      binding.BindOutput(m_output_names[i], make_tensor(outputs[i], shape));
+    } else {
+      binding.BindOutput(m_output_names[i], m_memory_info);
+    }
+  }
+}
+
+Ort::IoBinding &
+YOLO_ONNXRuntime::cached_binding(void *input, const std::vector<void *> &outputs,
+                                 int64_t batch) const {
+  struct Entry {
+    uint64_t session_id;
+    void *input;
+    std::vector<void *> outputs;
+    int64_t batch;
+    std::unique_ptr<Ort::IoBinding> binding;
+  };
+  // Per thread, since a binding serves one Run at a time. Keyed on the
+  // session id rather than its address, which a later session may reuse.
+  // Callers that never reuse their buffers would grow it without bound, so
+  // it starts over once full.
+  thread_local std::vector<Entry> cache;
+  for (Entry &entry : cache) {
+    if (entry.session_id == m_session_id && entry.input == input &&
+        entry.outputs == outputs && entry.batch == batch)
+      return *entry.binding;
+  }
+  if (cache.size() >= 64)
+    cache.clear();
+  Entry entry{m_session_id, input, outputs, batch,
+              std::make_unique<Ort::IoBinding>(*m_session)};
+  bind_io(*entry.binding, input, outputs, batch);
+  cache.push_back(std::move(entry));
+  return *cache.back().binding;
+}
+
+void YOLO_ONNXRuntime::run_io(Ort::IoBinding &binding,
+                              const std::vector<void *> &outputs) {
+  m_session->Run(Ort::RunOptions{nullptr}, binding);
+  if (m_static_outputs)
+    return;
+
+  // shapes only known after the run: the session allocated the outputs
+  std::vector<Ort::Value> values = binding.GetOutputValues();
+  size_t element_size = m_model_type == FP16 ? sizeof(uint16_t) : sizeof(float);
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    std::memcpy(outputs[i], values[i].GetTensorRawData(),
+                values[i].GetTensorTypeAndShapeInfo().GetElementCount() *
+                    element_size);
+  }
 }
 
 void YOLO_ONNXRuntime::release() {
   m_session->release();
-  m_env.release();
 }
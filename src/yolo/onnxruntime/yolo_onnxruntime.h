@@ -13,6 +13,8 @@
 #include "yolo_pose.h"
 #include "yolo_obb.h"
 #include "utils.h"
+#include "yuv_letterbox.h"
+#include "yolo_decoder.h"
 #include <onnxruntime_cxx_api.h>
 
 /**
@@ -40,9 +42,54 @@ public:
 
 protected:
 	/**
-	 * @description: infenence environment
+	 * @description: inference environment, one per process and shared by all sessions
+	 * @return {Env&}
 	 */
-	Ort::Env m_env;
+	static Ort::Env& env();
+
+	/**
+	 * @description: prepacked weights shared by all sessions when resources are shared
+	 * @return {PrepackedWeightsContainer&}
+	 */
+	static Ort::PrepackedWeightsContainer& prepacked_weights();
+
+	/**
+	 * @description: 					tensor over a caller-owned buffer, FP16 or FP32 as the model
+	 * @param {void*} data				tensor data
+	 * @param {vector<int64_t>} shape	tensor shape
+	 * @return {Value}
+	 */
+	Ort::Value make_tensor(void* data, const std::vector<int64_t>& shape) const;
+
+	/**
+	 * @description: 					bind the input and outputs of a batch to caller-owned buffers,
+	 * 									so the session reads and writes them in place
+	 * @param {IoBinding&} binding		binding to fill
+	 * @param {void*} input				input data, batch * m_input_numel elements
+	 * @param {vector<void*>} outputs	output buffers, one per output name, sized for batch
+	 * @param {int64_t} batch			batch size
+	 * @return {*}
+	 */
+	void bind_io(Ort::IoBinding& binding, void* input, const std::vector<void*>& outputs, int64_t batch) const;
+
+	/**
+	 * @description: 					binding of the calling thread for a set of buffers, made by
+	 * 									bind_io on first use and reused while the same buffers come
+	 * 									back, as recycled frame contexts do
+	 * @param {void*} input				input data, batch * m_input_numel elements
+	 * @param {vector<void*>} outputs	output buffers, one per output name, sized for batch
+	 * @param {int64_t} batch			batch size
+	 * @return {IoBinding&}				valid until the calling thread's next call
+	 */
+	Ort::IoBinding& cached_binding(void* input, const std::vector<void*>& outputs, int64_t batch) const;
+
+	/**
+	 * @description: 					run the session on a binding made by bind_io
+	 * @param {IoBinding&} binding		bound input and outputs
+	 * @param {vector<void*>} outputs	the output buffers given to bind_io
+	 * @return {*}
+	 */
+	void run_io(Ort::IoBinding& binding, const std::vector<void*>& outputs);
 
 	/**
 	 * @description: infenence session
@@ -54,35 +101,61 @@ protected:
 	 */
 	Ort::AllocatorWithDefaultOptions m_allocator;
 
+	/**
+	 * @description: memory info of the host buffers bound to the session
+	 */
+	Ort::MemoryInfo m_memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+	/**
+	 * @description: io binding of the member buffers, bound once in init
+	 */
+	std::unique_ptr<Ort::IoBinding> m_binding;
+
+	/**
+	 * @description: output buffers of m_binding
+	 */
+	std::vector<void*> m_bound_outputs;
+
+	/**
+	 * @description: output shapes as declared by the model
+	 */
+	std::vector<std::vector<int64_t>> m_output_shapes;
+
+	/**
+	 * @description: whether all output dimensions but the batch are fixed, so outputs can be
+	 * bound to preallocated buffers. Otherwise the session allocates them and run_io copies
+	 */
+	bool m_static_outputs = false;
+
 	/**
 	 * @description: input data
 	 */
-	std::vector<float> m_input;
+	aligned_vector<float> m_input;
 
 	/**
 	 * @description: input fp16 data 
 	 */
-	std::vector<uint16_t> m_input_fp16;
+	aligned_vector<uint16_t> m_input_fp16;
 	
 	/**
 	 * @description: output0 data
 	 */
-	std::vector<float> m_output0;
+	aligned_vector<float> m_output0;
 		
 	/**
 	 * @description: output1 data
 	 */
-	std::vector<float> m_output1;
+	aligned_vector<float> m_output1;
 
 	/**
 	 * @description: output0 fp16 data 
 	 */
-	std::vector<uint16_t> m_output0_fp16;
+	aligned_vector<uint16_t> m_output0_fp16;
 
 	/**
 	 * @description: output1 fp16 data 
 	 */
-	std::vector<uint16_t> m_output1_fp16;
+	aligned_vector<uint16_t> m_output1_fp16;
 
 	/**
 	 * @description: input node names
@@ -93,6 +166,16 @@ protected:
 	 * @description: output node names
 	 */
 	std::vector<const char*> m_output_names;
+
+	/**
+	 * @description: whether the model input has a dynamic batch dimension
+	 */
+	bool m_dynamic_batch = false;
+
+	/**
+	 * @description: id of the session, never reused, keys cached_binding
+	 */
+	uint64_t m_session_id = 0;
 };
 
 /**
@@ -147,7 +230,49 @@ public:
 	 */
 	void init(const Algo_Type algo_type, const Device_Type device_type, const Model_Type model_type, const std::string model_path);
 
+	/**
+	 * @description: 					pre-process stage, see YOLO_Detect
+	 * @param {SegmentContext&} context	frame context
+	 * @return {*}
+	 */
+	void pre_process_frame(SegmentContext &context) const;
+
+	/**
+	 * @description: 						inference stage, one session run for all frames
+	 * 										when the model has a dynamic batch dimension.
+	 * 										Safe to call from several threads at once
+	 * @param {vector<SegmentContext*>} contexts	frames to run
+	 * @return {*}
+	 */
+	void process_frames(std::vector<SegmentContext *> &contexts);
+
+	/**
+	 * @description: 	see YOLO_Detect, true when the model input has a dynamic batch dimension
+	 * @return {bool}
+	 */
+	bool supports_batch() const { return m_dynamic_batch; }
+
+	/**
+	 * @description: 					post-process stage, see YOLO_Detect. Every detection
+	 * 									gets a mask covering its box
+	 * @param {SegmentContext&} context	frame context
+	 * @return {*}
+	 */
+	void post_process_frame(SegmentContext &context) const;
+
 protected:
+	/**
+	 * @description: 						inference stage shared by the tasks: runs contexts in
+	 * 										batches when the model has a dynamic batch dimension and
+	 * 										writes each session output, as float, to its buffer in
+	 * 										every context. Safe to call from several threads at once
+	 * @param {vector<SegmentContext*>} contexts	frames to run
+	 * @param {vector<aligned_vector<float> SegmentContext::*>} outputs	context buffer of each session output
+	 * @param {vector<int>} numels		elements of each output per frame
+	 * @return {*}
+	 */
+	void run_frames(std::vector<SegmentContext *> &contexts, const std::vector<aligned_vector<float> SegmentContext::*> &outputs, const std::vector<int> &numels);
+
 	/**
 	 * @description: model pre-process
 	 * @return {*}
@@ -165,6 +290,50 @@ protected:
 	 * @return {*}
 	 */
 	void post_process();
+
+	/**
+	 * @description: size the member input and output buffers and bind them to the session
+	 * @return {*}
+	 */
+	void bind_members();
+
+	/**
+	 * @description: 						letterbox one frame into a model input tensor
+	 * @param {Mat&} image					BGR input, unused when use_yuv
+	 * @param {bool} use_yuv				whether the input is yuv
+	 * @param {YUVImage&} yuv				YUV 4:2:0 input
+	 * @param {Size&} image_size			size results are reported in
+	 * @param {aligned_vector<float>&} tensor		model input
+	 * @param {aligned_vector<uint16_t>&} tensor_fp16	model input for FP16 models
+	 * @param {Vec4d&} params				letterbox parameters
+	 * @return {*}
+	 */
+	void make_input(const cv::Mat& image, bool use_yuv, const YUVImage& yuv, const cv::Size& image_size, aligned_vector<float>& tensor, aligned_vector<uint16_t>& tensor_fp16, cv::Vec4d& params) const;
+
+	/**
+	 * @description: 					decoder arguments of one frame
+	 * @param {float*} output			output0 of the frame
+	 * @param {Size&} image_size		size results are reported in
+	 * @param {int} coeff_count			mask coefficients per anchor, 0 for detection
+	 * @return {DecodeArgs}
+	 */
+	DecodeArgs decode_args(const float* output, const cv::Size& image_size, int coeff_count) const;
+
+	/**
+	 * @description: 					decode the candidates of one frame and suppress them
+	 * @param {float*} output			output0 of the frame
+	 * @param {Size&} image_size		size results are reported in
+	 * @param {int} coeff_count			mask coefficients per anchor, 0 for detection
+	 * @param {Candidates&} candidates	decoded candidates, boxes scaled to image_size
+	 * @param {vector<int>&} indices	kept candidates, by descending score
+	 * @return {*}
+	 */
+	void detect(const float* output, const cv::Size& image_size, int coeff_count, Candidates& candidates, std::vector<int>& indices) const;
+
+	/**
+	 * @description: decoder of the output layout, chosen in init
+	 */
+	DecoderEntry m_decoder;
 };
 
 /**
@@ -183,6 +352,22 @@ public:
 	 */
 	void init(const Algo_Type algo_type, const Device_Type device_type, const Model_Type model_type, const std::string model_path);
 
+	/**
+	 * @description: 						inference stage, one session run for all frames
+	 * 										when the model has a dynamic batch dimension.
+	 * 										Safe to call from several threads at once
+	 * @param {vector<SegmentContext*>} contexts	frames to run
+	 * @return {*}
+	 */
+	void process_frames(std::vector<SegmentContext *> &contexts);
+
+	/**
+	 * @description: 					post-process stage, see YOLO_Detect
+	 * @param {SegmentContext&} context	frame context
+	 * @return {*}
+	 */
+	void post_process_frame(SegmentContext &context) const;
+
 private:
 	/**
 	 * @description: model pre-process
@@ -201,6 +386,58 @@ private:
 	 * @return {*}
 	 */
 	void post_process();
+
+	/**
+	 * @description: staging buffers for session outputs that need converting before decode
+	 */
+	struct OutputStage
+	{
+		aligned_vector<float> output0;
+		aligned_vector<float> output1;
+		aligned_vector<uint16_t> output0_fp16;
+		aligned_vector<uint16_t> output1_fp16;
+	};
+
+	/**
+	 * @description: 					where the session writes output0 and output1 of a batch:
+	 * 									for a single FP32 frame straight into output0/output1,
+	 * 									else into stage
+	 * @param {OutputStage&} stage		staging buffers, sized here
+	 * @param {aligned_vector<float>&} output0	detection output of a single frame
+	 * @param {aligned_vector<float>&} output1	mask prototypes of a single frame
+	 * @param {int64_t} batch			batch size
+	 * @return {vector<void*>}			output buffers for bind_io
+	 */
+	std::vector<void*> stage_outputs(OutputStage& stage, aligned_vector<float>& output0, aligned_vector<float>& output1, int64_t batch) const;
+
+	/**
+	 * @description: 					convert one frame of the session outputs to float, in the
+	 * 									model's layout. No-op for outputs written in place
+	 * @param {void*} raw0				output0 buffer from stage_outputs
+	 * @param {void*} raw1				output1 buffer from stage_outputs
+	 * @param {size_t} index			frame index in the batch
+	 * @param {aligned_vector<float>&} output0	detection output
+	 * @param {aligned_vector<float>&} output1	mask prototypes
+	 * @return {*}
+	 */
+	void unpack_outputs(const void* raw0, const void* raw1, size_t index, aligned_vector<float>& output0, aligned_vector<float>& output1) const;
+
+	/**
+	 * @description: 					decode boxes and masks of one frame. v8-v12 outputs are
+	 * 									read channel-major, as the model writes them
+	 * @param {aligned_vector<float>&} output0	detection output
+	 * @param {aligned_vector<float>&} output1	mask prototypes
+	 * @param {Size&} image_size		size results are reported in
+	 * @param {Vec4d&} params			letterbox parameters
+	 * @param {vector<OutputSeg>&} output_seg	result
+	 * @return {*}
+	 */
+	void decode(const aligned_vector<float> &output0, const aligned_vector<float> &output1, const cv::Size &image_size, const cv::Vec4d &params, std::vector<OutputSeg> &output_seg) const;
+
+	/**
+	 * @description: staging buffers of m_binding
+	 */
+	OutputStage m_stage;
 };
 
 /**
@@ -32,6 +32,9 @@ void YOLO_ONNXRuntime_Classify::init(const Algo_Type algo_type, const Device_Typ
 
 void YOLO_ONNXRuntime_Classify::pre_process()
 {
+	if (m_use_yuv)
+		m_image = yuv420_to_bgr(m_yuv);
+
 	cv::Mat crop_image;
 	if (m_algo_type == YOLOv5)
 	{
@@ -62,10 +65,7 @@ void YOLO_ONNXRuntime_Classify::pre_process()
 
 	if (m_model_type == FP16)
 	{
-		for (size_t i = 0; i < m_input_numel; i++)
-		{
-			m_input_fp16[i] = float32_to_float16(m_input[i]);
-		}
+		float32_to_float16(m_input.data(), m_input_fp16.data(), m_input_numel);
 	}
 }
 
@@ -73,7 +73,7 @@ void YOLO_ONNXRuntime_Classify::process()
 {
 	Ort::Value input_tensor{ nullptr };
 	auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-	std::vector<int64_t> input_node_dims = { 1, m_image.channels(), m_input_size.width, m_input_size.height };
+	std::vector<int64_t> input_node_dims = { 1, 3, m_input_size.width, m_input_size.height };
 
 	if (m_model_type == FP32 || m_model_type == INT8)
 		input_tensor = Ort::Value::CreateTensor(memory_info, m_input.data(), sizeof(float) * m_input_numel, input_node_dims.data(), input_node_dims.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
@@ -91,12 +91,8 @@ void YOLO_ONNXRuntime_Classify::process()
 	}
 	else if (m_model_type == FP16)
 	{
-		uint16_t* output0_fp16 = const_cast<uint16_t*>(outputs[0].GetTensorData<uint16_t>());
-		m_output0_fp16.assign(output0_fp16, output0_fp16 + m_class_num);
-		for (size_t i = 0; i < m_class_num; i++)
-		{
-			m_output0[i] = float16_to_float32(m_output0_fp16[i]);
-		}
+		const uint16_t* output0_fp16 = outputs[0].GetTensorData<uint16_t>();
+		float16_to_float32(output0_fp16, m_output0.data(), m_class_num);
 	}
 }
 
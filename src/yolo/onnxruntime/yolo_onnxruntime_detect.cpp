@@ -9,7 +9,8 @@
 
 void YOLO_ONNXRuntime_Detect::init(const Algo_Type algo_type, const Device_Type device_type, const Model_Type model_type, const std::string model_path)
 {
-	if (algo_type != YOLOv3 && algo_type != YOLOv4 && algo_type != YOLOv5 && algo_type != YOLOv6 && algo_type != YOLOv7 && algo_type != YOLOv8 && algo_type != YOLOv9 && algo_type != YOLOv10 && algo_type != YOLOv11 && algo_type != YOLOv12 && algo_type != YOLOv13 && algo_type != YOLO26)
+	m_decoder = find_decoder(algo_type, Detect);
+	if (!m_decoder.decode)
 	{
 		std::cerr << "unsupported algo type!" << std::endl;
 		std::exit(-1);
@@ -17,180 +18,234 @@ void YOLO_ONNXRuntime_Detect::init(const Algo_Type algo_type, const Device_Type
 	YOLO_ONNXRuntime::init(algo_type, device_type, model_type, model_path);
 	YOLO_Detect::init(algo_type, device_type, model_type, model_path);
 
+	bind_members();
+}
+
+void YOLO_ONNXRuntime_Detect::bind_members()
+{
+	m_input.resize(m_input_numel);
+	m_output0.resize(m_output_numdet);
 	if (m_model_type == FP16)
 	{
 		m_input_fp16.resize(m_input_numel);
-		m_output0.resize(m_output_numdet);
+		m_output0_fp16.resize(m_output_numdet);
 	}
+
+	// bound once: pre_process fills m_input in place and the session writes m_output0
+	void* input = m_model_type == FP16 ? static_cast<void*>(m_input_fp16.data()) : m_input.data();
+	m_bound_outputs = { m_model_type == FP16 ? static_cast<void*>(m_output0_fp16.data()) : m_output0.data() };
+	m_binding = std::make_unique<Ort::IoBinding>(*m_session);
+	bind_io(*m_binding, input, m_bound_outputs, 1);
 }
 
 void YOLO_ONNXRuntime_Detect::pre_process()
 {
-	cv::Mat letterbox;
-	LetterBox(m_image, letterbox, m_params, cv::Size(m_input_size.width, m_input_size.height));
-
-	cv::cvtColor(letterbox, letterbox, cv::COLOR_BGR2RGB);
-	letterbox.convertTo(letterbox, CV_32FC3, 1.0f / 255.0f);
-	
-	std::vector<cv::Mat> split_images;
-	cv::split(letterbox, split_images);
-	m_input.clear();
-	for (size_t i = 0; i < letterbox.channels(); ++i)
+	make_input(m_image, m_use_yuv, m_yuv, m_image_size, m_input, m_input_fp16, m_params);
+}
+
+void YOLO_ONNXRuntime_Detect::make_input(const cv::Mat& image, bool use_yuv, const YUVImage& yuv, const cv::Size& image_size, aligned_vector<float>& tensor, aligned_vector<uint16_t>& tensor_fp16, cv::Vec4d& params) const
+{
+	if (use_yuv)
+	{
+		tensor.resize(m_input_numel);
+		LetterBoxInfo info = yuv420_to_letterbox_tensor(yuv, cv::Size(m_input_size.width, m_input_size.height), tensor.data());
+		params = cv::Vec4d(info.ratio, info.ratio, info.left, info.top);
+	}
+	else
 	{
-		std::vector<float> split_image_data = split_images[i].reshape(1, 1);
-		m_input.insert(m_input.end(), split_image_data.begin(), split_image_data.end());
+		cv::Mat letterbox;
+		LetterBox(image, letterbox, params, cv::Size(m_input_size.width, m_input_size.height));
+		// pre-scaled frame: boxes map back to image_size, so the ratio must too
+		if (image.size() != image_size)
+			params[0] = params[1] = letterbox_info(image_size, m_input_size).ratio;
+
+		cv::cvtColor(letterbox, letterbox, cv::COLOR_BGR2RGB);
+		letterbox.convertTo(letterbox, CV_32FC3, 1.0f / 255.0f);
+
+		// split straight into the planes of tensor, which may be bound to the session
+		tensor.resize(m_input_numel);
+		std::vector<cv::Mat> split_images;
+		for (int i = 0; i < letterbox.channels(); ++i)
+			split_images.emplace_back(letterbox.rows, letterbox.cols, CV_32FC1, tensor.data() + i * letterbox.rows * letterbox.cols);
+		cv::split(letterbox, split_images);
 	}
 
 	if (m_model_type == FP16)
 	{
-		for (size_t i = 0; i < m_input_numel; i++)
-		{
-			m_input_fp16[i] = float32_to_float16(m_input[i]);
-		}
+		tensor_fp16.resize(m_input_numel);
+		float32_to_float16(tensor.data(), tensor_fp16.data(), m_input_numel);
 	}
 }
 
 void YOLO_ONNXRuntime_Detect::process()
 {
-	Ort::Value input_tensor{ nullptr };
-	auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-	std::vector<int64_t> input_node_dims = { 1, m_image.channels(), m_input_size.width, m_input_size.height };
-	
-	if(m_model_type == FP32 || m_model_type == INT8)
-		input_tensor = Ort::Value::CreateTensor(memory_info, m_input.data(), sizeof(float) * m_input_numel, input_node_dims.data(), input_node_dims.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);		
-	else if (m_model_type == FP16)
-		input_tensor = Ort::Value::CreateTensor(memory_info, m_input_fp16.data(), sizeof(uint16_t) * m_input_numel, input_node_dims.data(), input_node_dims.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
-	
-	std::vector<Ort::Value> inputs;
-	inputs.push_back(std::move(input_tensor)); 
-	std::vector<Ort::Value> outputs = m_session->Run(Ort::RunOptions{ nullptr }, m_input_names.data(), inputs.data(), m_input_names.size(), m_output_names.data(), m_output_names.size());
-
-	if (m_model_type == FP32 || m_model_type == INT8)
+	run_io(*m_binding, m_bound_outputs);
+
+	if (m_model_type == FP16)
 	{
-		m_output0_host = const_cast<float*>(outputs[0].GetTensorData<float>());
-		m_output0.assign(m_output0_host, m_output0_host + m_output_numdet);
+		float16_to_float32(m_output0_fp16.data(), m_output0.data(), m_output_numdet);
 	}
-	else if (m_model_type == FP16)
+}
+
+DecodeArgs YOLO_ONNXRuntime_Detect::decode_args(const float* output, const cv::Size& image_size, int coeff_count) const
+{
+	DecodeArgs args;
+	args.output = output;
+	args.numbox = m_output_numbox;
+	args.numprob = m_output_numprob;
+	args.class_num = m_class_num;
+	args.classes = &m_classes;
+	args.score_threshold = m_score_threshold;
+	args.confidence_threshold = m_confidence_threshold;
+	args.image_size = image_size;
+	args.input_size = m_input_size;
+	args.coeff_count = coeff_count;
+	return args;
+}
+
+void YOLO_ONNXRuntime_Detect::detect(const float* output, const cv::Size& image_size, int coeff_count, Candidates& candidates, std::vector<int>& indices) const
+{
+	m_decoder.decode(decode_args(output, image_size, coeff_count), candidates);
+	scale_boxes(candidates.boxes, image_size);
+
+	indices.clear();
+	if (m_decoder.nms_free)
 	{
-		uint16_t* output0_fp16 = const_cast<uint16_t*>(outputs[0].GetTensorData<uint16_t>());
-		m_output0_fp16.assign(output0_fp16, output0_fp16 + m_output_numdet);
-		for (size_t i = 0; i < m_output_numdet; i++)
-		{
-			m_output0[i] = float16_to_float32(m_output0_fp16[i]);
-		}
+		indices.resize(candidates.boxes.size());
+		for (int i = 0; i < candidates.boxes.size(); i++)
+			indices[i] = i;
+	}
+	else
+	{
+		nms(candidates.boxes, candidates.scores, m_score_threshold, m_nms_threshold, indices, &candidates.class_ids);
 	}
 }
 
 void YOLO_ONNXRuntime_Detect::post_process()
 {
-	std::vector<cv::Rect> boxes;
-	std::vector<float> scores;
-	std::vector<int> class_ids;
+	thread_local Candidates candidates;
+	std::vector<int> indices;
+	detect(m_output0.data(), m_image_size, 0, candidates, indices);
 
-	for (int i = 0; i < m_output_numbox; ++i)
+	m_output_det.clear();
+	m_output_det.resize(indices.size());
+	for (int i = 0; i < indices.size(); i++)
 	{
-		float* ptr = m_output0.data() + i * m_output_numprob;
-		int class_id;
-		float score;
-		if (m_algo_type == YOLOv3 || m_algo_type == YOLOv4 || m_algo_type == YOLOv6 || m_algo_type == YOLOv8 || m_algo_type == YOLOv9 || m_algo_type == YOLOv10 || m_algo_type == YOLOv11 || m_algo_type == YOLOv12 || m_algo_type == YOLOv13)
-		{
-			float* classes_scores = ptr + 4;
-			class_id = std::max_element(classes_scores, classes_scores + m_class_num) - classes_scores;
-			score = classes_scores[class_id];
-		}
-		else if (m_algo_type == YOLOv5 || m_algo_type == YOLOv7)
-		{
-			float objness = ptr[4];
-			if (objness < m_confidence_threshold)
-				continue;
-			float* classes_scores = ptr + 5;
-			class_id = std::max_element(classes_scores, classes_scores + m_class_num) - classes_scores;
-			score = classes_scores[class_id] * objness;
-		}
-		else if (m_algo_type == YOLO26)
-		{
-			score = ptr[4];
-			class_id = int(ptr[5]);
-		}
+		int idx = indices[i];
+		OutputDet output;
+		output.id = candidates.class_ids[idx];
+		output.score = candidates.scores[idx];
+		output.box = candidates.boxes[idx];
+		m_output_det[i] = output;
+	}
+
+	if(m_draw_result)
+		draw_result(m_output_det);
+}
 
-		if (score < m_score_threshold)
-			continue;
+void YOLO_ONNXRuntime_Detect::pre_process_frame(SegmentContext& context) const
+{
+	const BatchInput& input = context.input;
+	bool use_yuv = input.image.empty();
+	if (use_yuv)
+		context.image_size = cv::Size(input.yuv.width, input.yuv.height);
+	else
+		context.image_size = input.source_size.empty() ? input.image.size() : input.source_size;
+	make_input(input.image, use_yuv, input.yuv, context.image_size, context.tensor, context.tensor_fp16, context.params);
+}
+
+void YOLO_ONNXRuntime_Detect::process_frames(std::vector<SegmentContext*>& contexts)
+{
+	run_frames(contexts, { &SegmentContext::output0 }, { m_output_numdet });
+}
+
+void YOLO_ONNXRuntime_Detect::run_frames(std::vector<SegmentContext*>& contexts, const std::vector<aligned_vector<float> SegmentContext::*>& outputs, const std::vector<int>& numels)
+{
+	// Bindings and staging buffers are per thread: callers may share this
+	// object and run concurrently. Bindings are kept for the buffers they were
+	// made for, so recycled contexts bind once.
+	thread_local aligned_vector<float> batch_input;
+	thread_local aligned_vector<uint16_t> batch_input_fp16;
+	thread_local std::vector<aligned_vector<float>> batch_outputs;
+	thread_local std::vector<aligned_vector<uint16_t>> batch_outputs_fp16;
+	const bool fp16 = m_model_type == FP16;
+	const size_t batch = (contexts.size() < 2 || !m_dynamic_batch) ? 1 : contexts.size();
+	if (batch_outputs.size() < outputs.size())
+	{
+		batch_outputs.resize(outputs.size());
+		batch_outputs_fp16.resize(outputs.size());
+	}
 
-		cv::Rect box;
-		if(m_algo_type == YOLOv3 || m_algo_type == YOLOv5 || m_algo_type == YOLOv6 || m_algo_type == YOLOv7 || m_algo_type == YOLOv8 || m_algo_type == YOLOv9 || m_algo_type == YOLOv11 || m_algo_type == YOLOv12 || m_algo_type == YOLOv13)
+	for (size_t first = 0; first < contexts.size(); first += batch)
+	{
+		// A single frame is bound to the context's own buffers; a batch is
+		// gathered into one NCHW tensor for one session run.
+		void* input;
+		if (batch == 1)
 		{
-			float x = ptr[0];
-			float y = ptr[1];
-			float w = ptr[2];
-			float h = ptr[3];
-			int left = int(x - 0.5 * w) > 0 ? int(x - 0.5 * w) : 0;
-			int top = int(y - 0.5 * h) > 0 ? int(y - 0.5 * h) : 0;
-			int width = int(w) > 0 ? int(w) : 0;
-			int height = int(h)> 0 ? int(h) : 0;
-			width = (left + width) < m_image.cols ? width : (m_image.cols - left);
-			height = (top + height) < m_image.rows ? height : (m_image.rows - top);
-			box = cv::Rect(left, top, width, height);
+			input = fp16 ? static_cast<void*>(contexts[first]->tensor_fp16.data()) : contexts[first]->tensor.data();
 		}
-		else if (m_algo_type == YOLOv4)
+		else if (fp16)
 		{
-			float x1 = ptr[0] * m_input_size.width;
-			float y1 = ptr[1] * m_input_size.height;
-			float x2 = ptr[2] * m_input_size.width;
-			float y2 = ptr[3] * m_input_size.height;
-			int left = int(x1) > 0 ? int(x1) : 0;
-			int top = int(y1) > 0 ? int(y1) : 0;
-			int width = int(x2 - x1) > 0 ? int(x2 - x1) : 0;
-			int height = int(y2 - y1)> 0 ? int(y2 - y1) : 0;
-			box = cv::Rect(left, top, width, height);
+			batch_input_fp16.resize(batch * m_input_numel);
+			for (size_t b = 0; b < batch; ++b)
+				std::copy_n(contexts[first + b]->tensor_fp16.begin(), m_input_numel, batch_input_fp16.begin() + b * m_input_numel);
+			input = batch_input_fp16.data();
 		}
-		else if (m_algo_type == YOLOv10 || m_algo_type == YOLO26)
+		else
 		{
-			int left = int(ptr[0]) > 0 ? int(ptr[0]) : 0;
-			int top = int(ptr[1]) > 0 ? int(ptr[1]) : 0;
-			int width = int(ptr[2] - ptr[0]) > 0 ? int(ptr[2] - ptr[0]) : 0;
-			int height = int(ptr[3] - ptr[1])> 0 ? int(ptr[3] - ptr[1]) : 0;
-			width = (left + width) < m_image.cols ? width : (m_image.cols - left);
-			height = (top + height) < m_image.rows ? height : (m_image.rows - top);
-			box = cv::Rect(left, top, width, height);
+			batch_input.resize(batch * m_input_numel);
+			for (size_t b = 0; b < batch; ++b)
+				std::copy_n(contexts[first + b]->tensor.begin(), m_input_numel, batch_input.begin() + b * m_input_numel);
+			input = batch_input.data();
 		}
 
-		boxes.push_back(box);
-		scores.push_back(score);
-		class_ids.push_back(class_id);
-	}
-
-	scale_boxes(boxes, m_image.size());
-
-	if(m_algo_type == YOLO26)
-	{
-		m_output_det.clear();
-		m_output_det.resize(boxes.size());
-		for (int i = 0; i < boxes.size(); i++)
+		std::vector<void*> buffers(outputs.size());
+		for (size_t i = 0; i < outputs.size(); ++i)
 		{
-			OutputDet output;
-			output.id = class_ids[i];
-			output.score = scores[i];
-			output.box = boxes[i];
-			m_output_det[i] = output;
+			if (fp16)
+			{
+				batch_outputs_fp16[i].resize(batch * numels[i]);
+				buffers[i] = batch_outputs_fp16[i].data();
+			}
+			else if (batch == 1)
+			{
+				aligned_vector<float>& output = contexts[first]->*outputs[i];
+				output.resize(numels[i]);
+				buffers[i] = output.data();
+			}
+			else
+			{
+				batch_outputs[i].resize(batch * numels[i]);
+				buffers[i] = batch_outputs[i].data();
+			}
 		}
-	}
-	else
-	{
-		std::vector<int> indices;
-		nms(boxes, scores, m_score_threshold, m_nms_threshold, indices);
-		m_output_det.clear();
-		m_output_det.resize(indices.size());
-		for (int i = 0; i < indices.size(); i++)
+		run_io(cached_binding(input, buffers, batch), buffers);
+
+		for (size_t b = 0; b < batch; ++b)
 		{
-			int idx = indices[i];
-			OutputDet output;
-			output.id = class_ids[idx];
-			output.score = scores[idx];
-			output.box = boxes[idx];
-			m_output_det[i] = output;
+			for (size_t i = 0; i < outputs.size(); ++i)
+			{
+				aligned_vector<float>& output = contexts[first + b]->*outputs[i];
+				output.resize(numels[i]);
+				if (fp16)
+					float16_to_float32(batch_outputs_fp16[i].data() + b * numels[i], output.data(), numels[i]);
+				else if (batch > 1)
+					std::copy_n(batch_outputs[i].begin() + b * numels[i], numels[i], output.begin());
+			}
 		}
 	}
+}
 
-	if(m_draw_result)
-		draw_result(m_output_det);
-}
\ No newline at end of file
+void YOLO_ONNXRuntime_Detect::post_process_frame(SegmentContext& context) const
+{
+	thread_local Candidates candidates;
+	thread_local std::vector<int> indices;
+	detect(context.output0.data(), context.image_size, 0, candidates, indices);
+
+	cv::Rect image_rect(0, 0, context.image_size.width, context.image_size.height);
+	context.output_seg.clear();
+	context.output_seg.reserve(indices.size());
+	for (int idx : indices)
+		context.output_seg.push_back({ candidates.class_ids[idx], candidates.scores[idx], candidates.boxes[idx] & image_rect, cv::Mat(), box_proto_mask() });
+}
@@ -26,27 +26,36 @@ void YOLO_ONNXRuntime_OBB::init(const Algo_Type algo_type, const Device_Type dev
 
 void YOLO_ONNXRuntime_OBB::pre_process()
 {
-	cv::Mat letterbox;
-	LetterBox(m_image, letterbox, m_params, cv::Size(m_input_size.width, m_input_size.height));
+	if (m_use_yuv)
+	{
+		m_input.resize(m_input_numel);
+		LetterBoxInfo info = yuv420_to_letterbox_tensor(m_yuv, cv::Size(m_input_size.width, m_input_size.height), m_input.data());
+		m_params = cv::Vec4d(info.ratio, info.ratio, info.left, info.top);
+	}
+	else
+	{
+		cv::Mat letterbox;
+		LetterBox(m_image, letterbox, m_params, cv::Size(m_input_size.width, m_input_size.height));
+		// pre-scaled frame: boxes map back to m_image_size, so the ratio must too
+		if (m_image.size() != m_image_size)
+			m_params[0] = m_params[1] = letterbox_info(m_image_size, m_input_size).ratio;
 
-	cv::cvtColor(letterbox, letterbox, cv::COLOR_BGR2RGB);
-	letterbox.convertTo(letterbox, CV_32FC3, 1.0f / 255.0f);
+		cv::cvtColor(letterbox, letterbox, cv::COLOR_BGR2RGB);
+		letterbox.convertTo(letterbox, CV_32FC3, 1.0f / 255.0f);
 	
-	std::vector<cv::Mat> split_images;
-	cv::split(letterbox, split_images);
-	m_input.clear();
-	for (size_t i = 0; i < letterbox.channels(); ++i)
-	{
-		std::vector<float> split_image_data = split_images[i].reshape(1, 1);
-		m_input.insert(m_input.end(), split_image_data.begin(), split_image_data.end());
+		std::vector<cv::Mat> split_images;
+		cv::split(letterbox, split_images);
+		m_input.clear();
+		for (size_t i = 0; i < letterbox.channels(); ++i)
+		{
+			std::vector<float> split_image_data = split_images[i].reshape(1, 1);
+			m_input.insert(m_input.end(), split_image_data.begin(), split_image_data.end());
+		}
 	}
 
 	if (m_model_type == FP16)
 	{
-		for (size_t i = 0; i < m_input_numel; i++)
-		{
-			m_input_fp16[i] = float32_to_float16(m_input[i]);
-		}
+		float32_to_float16(m_input.data(), m_input_fp16.data(), m_input_numel);
 	}
 }
 
@@ -54,7 +63,7 @@ void YOLO_ONNXRuntime_OBB::process()
 {
 	Ort::Value input_tensor{ nullptr };
 	auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-	std::vector<int64_t> input_node_dims = { 1, m_image.channels(), m_input_size.width, m_input_size.height };
+	std::vector<int64_t> input_node_dims = { 1, 3, m_input_size.width, m_input_size.height };
 	
 	if(m_model_type == FP32 || m_model_type == INT8)
 		input_tensor = Ort::Value::CreateTensor(memory_info, m_input.data(), sizeof(float) * m_input_numel, input_node_dims.data(), input_node_dims.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);		
@@ -72,12 +81,8 @@ void YOLO_ONNXRuntime_OBB::process()
 	}
 	else if (m_model_type == FP16)
 	{
-		uint16_t* output0_fp16 = const_cast<uint16_t*>(outputs[0].GetTensorData<uint16_t>());
-		m_output0_fp16.assign(output0_fp16, output0_fp16 + m_output_numdet);
-		for (size_t i = 0; i < m_output_numdet; i++)
-		{
-			m_output0[i] = float16_to_float32(m_output0_fp16[i]);
-		}
+		const uint16_t* output0_fp16 = outputs[0].GetTensorData<uint16_t>();
+		float16_to_float32(output0_fp16, m_output0.data(), m_output_numdet);
 	}
 }
 
@@ -106,7 +111,9 @@ void YOLO_ONNXRuntime_OBB::post_process()
 		}
 		else if(m_algo_type == YOLO26)
 		{
-			if (ptr[4] < m_score_threshold)
+			score = ptr[4];
+			class_id = int(ptr[5]);
+			if (score < m_score_threshold)
 				continue;
 			std::copy(ptr, ptr + 7, rbox.begin());
 		}
@@ -126,7 +133,7 @@ void YOLO_ONNXRuntime_OBB::post_process()
 
 	regularize_rboxes(boxes_nms);
 	
-	scale_rboxes(boxes_nms, m_image.size());
+	scale_rboxes(boxes_nms, m_image_size);
 
 	m_output_obb.clear();
 	m_output_obb.resize(indices.size());
@@ -17,12 +17,7 @@ void YOLO_ONNXRuntime_Pose::init(const Algo_Type algo_type, const Device_Type de
 	YOLO_ONNXRuntime::init(algo_type, device_type, model_type, model_path);
 	YOLO_Pose::init(algo_type, device_type, model_type, model_path);
 
-	m_output0.resize(m_output_numdet);
-	if (m_model_type == FP16)
-	{
-		m_input_fp16.resize(m_input_numel);
-		m_output0_fp16.resize(m_output_numdet);
-	}
+	bind_members();
 }
 
 void YOLO_ONNXRuntime_Pose::pre_process()
@@ -62,8 +57,8 @@ void YOLO_ONNXRuntime_Pose::post_process()
 			int top = int(y - 0.5 * h) > 0 ? int(y - 0.5 * h) : 0;
 			int width = int(w) > 0 ? int(w) : 0;
 			int height = int(h)> 0 ? int(h) : 0;
-			width = (left + width) < m_image.cols ? width : (m_image.cols - left);
-			height = (top + height) < m_image.rows ? height : (m_image.rows - top);
+			width = (left + width) < m_image_size.width ? width : (m_image_size.width - left);
+			height = (top + height) < m_image_size.height ? height : (m_image_size.height - top);
 			box = cv::Rect(left, top, width, height);
 			for (int j = 0; j < keypoint.size(); j++)
 			{
@@ -76,8 +71,8 @@ void YOLO_ONNXRuntime_Pose::post_process()
 			int top = int(ptr[1]) > 0 ? int(ptr[1]) : 0;
 			int width = int(ptr[2] - ptr[0]) > 0 ? int(ptr[2] - ptr[0]) : 0;
 			int height = int(ptr[3] - ptr[1])> 0 ? int(ptr[3] - ptr[1]) : 0;
-			width = (left + width) < m_image.cols ? width : (m_image.cols - left);
-			height = (top + height) < m_image.rows ? height : (m_image.rows - top);
+			width = (left + width) < m_image_size.width ? width : (m_image_size.width - left);
+			height = (top + height) < m_image_size.height ? height : (m_image_size.height - top);
 			box = cv::Rect(left, top, width, height);
 			for (int j = 0; j < keypoint.size(); j++)
 			{
@@ -90,7 +85,7 @@ void YOLO_ONNXRuntime_Pose::post_process()
 		keypoints.push_back(keypoint);
 	}
 
-	scale_boxes(boxes, keypoints, m_image.size());
+	scale_boxes(boxes, keypoints, m_image_size);
 
 	if (m_algo_type == YOLOv8 || m_algo_type == YOLOv11 || m_algo_type == YOLOv12)
 	{
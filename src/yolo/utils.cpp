@@ -7,6 +7,16 @@
 
 #include "utils.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define UTILS_X86 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define UTILS_NEON 1
+#endif
+
 uint16_t float32_to_float16(float value)
 {
 	// 1 : 8 : 23
@@ -18,47 +28,42 @@ uint16_t float32_to_float16(float value)
 
 	tmp.f = value;
 
-	// 1 : 8 : 23
-	uint16_t sign = (tmp.u & 0x80000000) >> 31;
-	uint16_t exponent = (tmp.u & 0x7F800000) >> 23;
-	unsigned int significand = tmp.u & 0x7FFFFF;
-
-	//     NCNN_LOGE("%d %d %d", sign, exponent, significand);
-
-	// 1 : 5 : 10
-	uint16_t fp16;
-	if (exponent == 0)
+	// 1 : 5 : 10, rounded to nearest even like vcvtps2ph
+	uint16_t sign = (tmp.u >> 16) & 0x8000;
+	unsigned int abs = tmp.u & 0x7FFFFFFF;
+	if (abs >= 0x7F800000)
 	{
-		// zero or denormal, always underflow
-		fp16 = (sign << 15) | (0x00 << 10) | 0x00;
+		// infinity or NaN, NaN stays quiet and keeps its top payload bits
+		return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 | ((abs >> 13) & 0x3FF) : 0x00);
 	}
-	else if (exponent == 0xFF)
+	if (abs >= 0x477FF000)
 	{
-		// infinity or NaN
-		fp16 = (sign << 15) | (0x1F << 10) | (significand ? 0x200 : 0x00);
+		// 65520 and above round to infinity
+		return sign | 0x7C00;
 	}
-	else
+	if (abs < 0x38800000)
 	{
-		// normalized
-		short newexp = exponent + (-127 + 15);
-		if (newexp >= 31)
-		{
-			// overflow, return infinity
-			fp16 = (sign << 15) | (0x1F << 10) | 0x00;
-		}
-		else if (newexp <= 0)
-		{
-			// Some normal fp32 cannot be expressed as normal fp16
-			fp16 = (sign << 15) | (0x00 << 10) | 0x00;
-		}
-		else
-		{
-			// normal fp16
-			fp16 = (sign << 15) | (newexp << 10) | (significand >> 13);
-		}
+		// below the smallest normal fp16: denormal, or zero under 2^-25
+		unsigned int exponent = abs >> 23;
+		if (exponent < 102)
+			return sign;
+		unsigned int significand = (abs & 0x7FFFFF) | 0x800000;
+		unsigned int shift = 126 - exponent;
+		unsigned int fp16 = significand >> shift;
+		unsigned int rest = significand & ((1u << shift) - 1);
+		unsigned int half = 1u << (shift - 1);
+		if (rest > half || (rest == half && (fp16 & 1)))
+			fp16++;
+		return sign | fp16;
 	}
 
-	return fp16;
+	// normal fp16: rebias the exponent, round the 13 dropped bits; a carry
+	// into the exponent is still the correct encoding
+	unsigned int fp16 = (abs - 0x38000000) >> 13;
+	unsigned int rest = abs & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (fp16 & 1)))
+		fp16++;
+	return sign | fp16;
 }
 
 float float16_to_float32(uint16_t value)
@@ -100,8 +105,8 @@ float float16_to_float32(uint16_t value)
 	}
 	else if (exponent == 0x1F)
 	{
-		// infinity or NaN
-		tmp.u = (sign << 31) | (0xFF << 23) | (significand << 13);
+		// infinity or NaN, NaN quieted as vcvtph2ps does
+		tmp.u = (sign << 31) | (0xFF << 23) | (significand << 13) | (significand ? 0x400000 : 0);
 	}
 	else
 	{
@@ -110,4 +115,83 @@ float float16_to_float32(uint16_t value)
 	}
 
 	return tmp.f;
-}
\ No newline at end of file
+}
+
+#ifdef UTILS_X86
+static bool cpu_has_f16c()
+{
+	static const bool has = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	return has;
+}
+
+static bool cpu_has_avx512()
+{
+	static const bool has = __builtin_cpu_supports("avx512f");
+	return has;
+}
+
+// The SIMD versions convert whole vectors and return where the scalar tail starts.
+__attribute__((target("avx512f"))) static size_t float32_to_float16_avx512(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	return i;
+}
+
+__attribute__((target("avx512f"))) static size_t float16_to_float32_avx512(const uint16_t* src, float* dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+		_mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(src + i))));
+	return i;
+}
+
+__attribute__((target("avx,f16c"))) static size_t float32_to_float16_f16c(const float* src, uint16_t* dst, size_t count, size_t i)
+{
+	for (; i + 8 <= count; i += 8)
+		_mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+	return i;
+}
+
+__attribute__((target("avx,f16c"))) static size_t float16_to_float32_f16c(const uint16_t* src, float* dst, size_t count, size_t i)
+{
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+	return i;
+}
+#endif
+
+void float32_to_float16(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+#ifdef UTILS_X86
+	if (cpu_has_avx512())
+		i = float32_to_float16_avx512(src, dst, count);
+	if (cpu_has_f16c())
+		i = float32_to_float16_f16c(src, dst, count, i);
+#endif
+#ifdef UTILS_NEON
+	for (; i + 4 <= count; i += 4)
+		vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+#endif
+	for (; i < count; i++)
+		dst[i] = float32_to_float16(src[i]);
+}
+
+void float16_to_float32(const uint16_t* src, float* dst, size_t count)
+{
+	size_t i = 0;
+#ifdef UTILS_X86
+	if (cpu_has_avx512())
+		i = float16_to_float32_avx512(src, dst, count);
+	if (cpu_has_f16c())
+		i = float16_to_float32_f16c(src, dst, count, i);
+#endif
+#ifdef UTILS_NEON
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+#endif
+	for (; i < count; i++)
+		dst[i] = float16_to_float32(src[i]);
+}
@@ -8,10 +8,11 @@
 #pragma once
 
 #include <iostream>
+#include <cstddef>
 #include <cstdint>
 
 /**
- * @description:   float32 to float16, refer to https://github.com/Tencent/ncnn/blob/master/src/mat.cpp
+ * @description:   float32 to float16, rounded to nearest even, denormals kept
  * @return {*}     float16 
  */
 uint16_t float32_to_float16(float value);
@@ -21,3 +22,22 @@ uint16_t float32_to_float16(float value);
  * @return {*}     float32 
  */
 float float16_to_float32(uint16_t value);
+
+/**
+ * @description:          convert count floats to float16 with F16C, AVX-512 or NEON when the CPU
+ *                        has them, rounding like the scalar version
+ * @param {float*} src    input
+ * @param {uint16_t*} dst output
+ * @param {size_t} count  element count
+ * @return {*}
+ */
+void float32_to_float16(const float* src, uint16_t* dst, size_t count);
+
+/**
+ * @description:          convert count float16 values to float, vectorized like float32_to_float16
+ * @param {uint16_t*} src input
+ * @param {float*} dst    output
+ * @param {size_t} count  element count
+ * @return {*}
+ */
+void float16_to_float32(const uint16_t* src, float* dst, size_t count);
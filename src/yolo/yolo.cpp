@@ -32,7 +32,10 @@
 void YOLO::infer_image(const cv::Mat &image) {
   if (image.empty())
     return;
-  m_image = image.clone();
+  // pre_process never writes to m_image, so a shared header is enough
+  m_image = image;
+  m_image_size = image.size();
+  m_use_yuv = false;
   m_draw_result = true;
 
   pre_process();
@@ -40,6 +43,48 @@ void YOLO::infer_image(const cv::Mat &image) {
   post_process();
 }
 
+void YOLO::infer_yuv(const YUVImage &image) {
+  if (image.data[0] == nullptr || image.width < 4 || image.height < 4)
+    return;
+  m_yuv = image;
+  m_use_yuv = true;
+  m_image.release();
+  m_image_size = cv::Size(image.width, image.height);
+  m_draw_result = false;
+
+  pre_process();
+  process();
+  post_process();
+}
+
+void YOLO::infer_scaled(const cv::Mat &image, const cv::Size &source_size) {
+  if (image.empty() || source_size.empty())
+    return;
+  m_image = image;
+  m_image_size = source_size;
+  m_use_yuv = false;
+  m_draw_result = false;
+
+  pre_process();
+  process();
+  post_process();
+}
+
+void YOLO::set_input(const BatchInput &input) {
+  if (input.image.empty()) {
+    m_yuv = input.yuv;
+    m_use_yuv = true;
+    m_image.release();
+    m_image_size = cv::Size(input.yuv.width, input.yuv.height);
+  } else {
+    m_image = input.image;
+    m_use_yuv = false;
+    m_image_size =
+        input.source_size.empty() ? input.image.size() : input.source_size;
+  }
+  m_draw_result = false;
+}
+
 void YOLO::infer(const std::string file_path, bool save_result,
                  bool show_result, char *argv[]) {
   if (!std::filesystem::exists(file_path)) {
@@ -55,6 +100,8 @@ void YOLO::infer(const std::string file_path, bool save_result,
       std::cerr << "read image empty!" << std::endl;
       std::exit(-1);
     }
+    m_image_size = m_image.size();
+    m_use_yuv = false;
 
     // warm up
     for (int i = 0; i < 10; ++i) {
@@ -114,6 +161,8 @@ void YOLO::infer(const std::string file_path, bool save_result,
       if (m_image.empty()) {
         break;
       }
+      m_image_size = m_image.size();
+      m_use_yuv = false;
       m_result = m_image.clone();
 
       pre_process();
@@ -10,7 +10,9 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <new>
 #include <opencv2/opencv.hpp>
+#include <vector>
 
 #include "magic_enum.hpp"
 
@@ -71,6 +73,69 @@ enum Model_Type {
   INT8,
 };
 
+/**
+ * @description: allocator returning memory aligned to Alignment bytes, so
+ * tensors handed to a backend start on a cache line and suit aligned SIMD
+ * loads
+ */
+template <typename T, size_t Alignment = 64> struct AlignedAllocator {
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+
+  void deallocate(T *p, size_t) noexcept {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return false;
+  }
+};
+
+/**
+ * @description: vector with 64-byte aligned storage
+ */
+template <typename T> using aligned_vector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * @description: planar YUV 4:2:0 image view, e.g. the planes of a decoded
+ * AVFrame. The pixel data is not owned.
+ */
+struct YUVImage {
+  const uint8_t *data[3] = {nullptr, nullptr, nullptr};
+  int linesize[3] = {0, 0, 0};
+  int width = 0;
+  int height = 0;
+  bool full_range = false; // JPEG range instead of MPEG (16-235) range
+};
+
+/**
+ * @description: one frame of a batch: a BGR image (pre-scaled when
+ * source_size differs from its size, see infer_scaled) or, when image is
+ * empty, YUV 4:2:0 planes
+ */
+struct BatchInput {
+  cv::Mat image;
+  YUVImage yuv;
+  cv::Size source_size; // original frame size, empty = image size
+};
+
 /**
  * @description: interface class for YOLO algorithm
  */
@@ -112,6 +177,53 @@ public:
    */
   void infer_image(const cv::Mat &image);
 
+  /**
+   * @description:                inference interface for YUV 4:2:0 planes
+   * @param {YUVImage&} image     input planes, letterboxed straight into the
+   *                              model input tensor without a BGR copy
+   * @return {*}
+   */
+  void infer_yuv(const YUVImage &image);
+
+  /**
+   * @description:                inference interface for a frame that was
+   *                              already scaled to fit the model input, e.g.
+   *                              by the video decoder. Results are mapped back
+   *                              to source_size.
+   * @param {cv::Mat&} image      scaled input image
+   * @param {Size&} source_size   size of the original frame
+   * @return {*}
+   */
+  void infer_scaled(const cv::Mat &image, const cv::Size &source_size);
+
+  /**
+   * @description: model input size
+   * @return {Size}
+   */
+  cv::Size get_input_size() const { return m_input_size; }
+
+  /**
+   * @description:                inference threads of the backend, must be
+   *                              set before init
+   * @param {int} num_threads     number of threads
+   * @return {*}
+   */
+  void set_num_threads(int num_threads) { m_num_threads = num_threads; }
+
+  /**
+   * @description:                share prepacked weights and one intra-op
+   *                              thread pool among all instances of the
+   *                              backend in this process, must be set before
+   *                              the first init. Per-instance thread counts
+   *                              are then ignored
+   * @param {int} pool_threads    threads of the shared pool, 0 = per-instance
+   *                              pools and weights
+   * @return {*}
+   */
+  static void set_shared_resources(int pool_threads) {
+    s_shared_pool_threads = pool_threads;
+  }
+
   /**
    * @description: release interface
    * @return {*}
@@ -137,11 +249,35 @@ protected:
    */
   virtual void post_process() = 0;
 
+  /**
+   * @description:                set the per-frame input state used by
+   *                              pre_process and post_process
+   * @param {BatchInput&} input   input frame
+   * @return {*}
+   */
+  void set_input(const BatchInput &input);
+
   /**
    * @description: input image
    */
   cv::Mat m_image;
 
+  /**
+   * @description: input YUV planes, used instead of m_image when m_use_yuv
+   */
+  YUVImage m_yuv;
+
+  /**
+   * @description: whether the current input is m_yuv
+   */
+  bool m_use_yuv = false;
+
+  /**
+   * @description: size of the current input image, in the coordinates results
+   * are reported in. Differs from m_image.size() after infer_scaled()
+   */
+  cv::Size m_image_size;
+
   /**
    * @description: result
    */
@@ -171,6 +307,16 @@ protected:
    * @description: draw result
    */
   bool m_draw_result;
+
+  /**
+   * @description: inference threads of the backend
+   */
+  int m_num_threads = 1;
+
+  /**
+   * @description: threads of the process-wide pool, 0 when not shared
+   */
+  static inline int s_shared_pool_threads = 0;
 };
 
 /**
@@ -0,0 +1,217 @@
+/*
+ * @Description: compile-time specialised decoders of YOLO outputs
+ */
+
+#include "yolo_decoder.h"
+#include "channel_major.h"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @description: how an anchor stores its box
+ */
+enum class BoxFormat {
+  CXCYWH,         // centre and size, input pixels
+  XYXY,           // corners, input pixels
+  XYXYNormalized, // corners relative to the input size (v4)
+};
+
+bool has_classes(const DecodeArgs &args) {
+  return args.classes && !args.classes->empty();
+}
+
+/**
+ * @description: best class among the allowed ones of an anchor-major row
+ */
+float best_class(const float *scores, const DecodeArgs &args, int &class_id) {
+  if (!has_classes(args)) {
+    class_id = int(std::max_element(scores, scores + args.class_num) - scores);
+    return scores[class_id];
+  }
+  const std::vector<int> &classes = *args.classes;
+  class_id = classes[0];
+  for (int id : classes) {
+    if (scores[id] > scores[class_id])
+      class_id = id;
+  }
+  return scores[class_id];
+}
+
+template <BoxFormat Format>
+cv::Rect to_rect(const float *box, const DecodeArgs &args) {
+  const cv::Size &image_size = args.image_size;
+  if constexpr (Format == BoxFormat::CXCYWH) {
+    float x = box[0], y = box[1], w = box[2], h = box[3];
+    int left = int(x - 0.5 * w) > 0 ? int(x - 0.5 * w) : 0;
+    int top = int(y - 0.5 * h) > 0 ? int(y - 0.5 * h) : 0;
+    int width = int(w) > 0 ? int(w) : 0;
+    int height = int(h) > 0 ? int(h) : 0;
+    width = (left + width) < image_size.width ? width : (image_size.width - left);
+    height = (top + height) < image_size.height ? height : (image_size.height - top);
+    return cv::Rect(left, top, width, height);
+  } else if constexpr (Format == BoxFormat::XYXY) {
+    int left = int(box[0]) > 0 ? int(box[0]) : 0;
+    int top = int(box[1]) > 0 ? int(box[1]) : 0;
+    int width = int(box[2] - box[0]) > 0 ? int(box[2] - box[0]) : 0;
+    int height = int(box[3] - box[1]) > 0 ? int(box[3] - box[1]) : 0;
+    width = (left + width) < image_size.width ? width : (image_size.width - left);
+    height = (top + height) < image_size.height ? height : (image_size.height - top);
+    return cv::Rect(left, top, width, height);
+  } else {
+    float x1 = box[0] * args.input_size.width;
+    float y1 = box[1] * args.input_size.height;
+    float x2 = box[2] * args.input_size.width;
+    float y2 = box[3] * args.input_size.height;
+    int left = int(x1) > 0 ? int(x1) : 0;
+    int top = int(y1) > 0 ? int(y1) : 0;
+    int width = int(x2 - x1) > 0 ? int(x2 - x1) : 0;
+    int height = int(y2 - y1) > 0 ? int(y2 - y1) : 0;
+    return cv::Rect(left, top, width, height);
+  }
+}
+
+/**
+ * @description:                 decoder of one layout. Channel-major outputs
+ *                               ([numprob x numbox]) find their candidates
+ *                               with a column-wise argmax over the class rows
+ *                               and gather only the candidates' columns.
+ *                               Anchor-major outputs ([numbox x numprob]) are
+ *                               scanned row by row; objectness heads gate on
+ *                               ptr[4] and scale the class score by it, and
+ *                               NMS-free heads carry score and class id at
+ *                               ptr[4] and ptr[5]
+ */
+template <bool ChannelMajor, BoxFormat Format, bool Objectness, bool NmsFree>
+void decode(const DecodeArgs &args, Candidates &out) {
+  static_assert(!(ChannelMajor && (Objectness || NmsFree)),
+                "channel-major heads have neither objectness nor NMS-free "
+                "outputs");
+  constexpr int class_offset = Objectness ? 5 : 4;
+  const int coeff_offset = NmsFree ? 6 : class_offset + args.class_num;
+  out.clear();
+
+  if constexpr (ChannelMajor) {
+    const int numbox = args.numbox;
+    thread_local std::vector<float> best_scores;
+    thread_local std::vector<int> best_classes;
+    thread_local std::vector<int> selected;
+    best_scores.resize(numbox);
+    best_classes.resize(numbox);
+    // With an allow-list only the listed class rows are read.
+    const float *class_rows = args.output + size_t(class_offset) * numbox;
+    if (has_classes(args))
+      column_argmax(class_rows, args.classes->data(),
+                    int(args.classes->size()), numbox, best_scores.data(),
+                    best_classes.data());
+    else
+      column_argmax(class_rows, args.class_num, numbox, best_scores.data(),
+                    best_classes.data());
+    select_columns(best_scores.data(), numbox, args.score_threshold,
+                   selected);
+
+    out.coeffs.resize(selected.size() * args.coeff_count);
+    float *coeffs = out.coeffs.data();
+    for (int i : selected) {
+      float box[4];
+      for (int p = 0; p < 4; ++p)
+        box[p] = args.output[size_t(p) * numbox + i];
+      out.boxes.push_back(to_rect<Format>(box, args));
+      out.scores.push_back(best_scores[i]);
+      out.class_ids.push_back(best_classes[i]);
+      for (int c = 0; c < args.coeff_count; ++c)
+        *coeffs++ = args.output[size_t(coeff_offset + c) * numbox + i];
+    }
+  } else {
+    for (int i = 0; i < args.numbox; ++i) {
+      const float *ptr = args.output + size_t(i) * args.numprob;
+      int class_id;
+      float score;
+      if constexpr (NmsFree) {
+        score = ptr[4];
+        class_id = int(ptr[5]);
+        if (has_classes(args) &&
+            !std::binary_search(args.classes->begin(), args.classes->end(),
+                                class_id))
+          continue;
+      } else if constexpr (Objectness) {
+        if (ptr[4] < args.confidence_threshold)
+          continue;
+        score = best_class(ptr + class_offset, args, class_id) * ptr[4];
+      } else {
+        score = best_class(ptr + class_offset, args, class_id);
+      }
+      if (score < args.score_threshold)
+        continue;
+
+      out.boxes.push_back(to_rect<Format>(ptr, args));
+      out.scores.push_back(score);
+      out.class_ids.push_back(class_id);
+      out.coeffs.insert(out.coeffs.end(), ptr + coeff_offset,
+                        ptr + coeff_offset + args.coeff_count);
+    }
+  }
+}
+
+constexpr DecoderEntry anchor_xywh = {
+    decode<false, BoxFormat::CXCYWH, false, false>, false};
+constexpr DecoderEntry anchor_xywh_obj = {
+    decode<false, BoxFormat::CXCYWH, true, false>, false};
+constexpr DecoderEntry anchor_xyxy = {
+    decode<false, BoxFormat::XYXY, false, false>, false};
+constexpr DecoderEntry anchor_xyxy_norm = {
+    decode<false, BoxFormat::XYXYNormalized, false, false>, false};
+constexpr DecoderEntry anchor_xyxy_nms_free = {
+    decode<false, BoxFormat::XYXY, false, true>, true};
+constexpr DecoderEntry channel_xywh = {
+    decode<true, BoxFormat::CXCYWH, false, false>, false};
+constexpr DecoderEntry none = {};
+
+// Indexed by Algo_Type. Detection outputs are anchor-major for every model;
+// v8-v12 segmentation outputs keep the exporter's channel-major layout.
+constexpr DecoderEntry detect_table[] = {
+    anchor_xywh,          // YOLOv3
+    anchor_xyxy_norm,     // YOLOv4
+    anchor_xywh_obj,      // YOLOv5
+    anchor_xywh,          // YOLOv6
+    anchor_xywh_obj,      // YOLOv7
+    anchor_xywh,          // YOLOv8
+    anchor_xywh,          // YOLOv9
+    anchor_xyxy,          // YOLOv10
+    anchor_xywh,          // YOLOv11
+    anchor_xywh,          // YOLOv12
+    anchor_xywh,          // YOLOv13
+    anchor_xyxy_nms_free, // YOLO26
+};
+
+constexpr DecoderEntry segment_table[] = {
+    none,                 // YOLOv3
+    none,                 // YOLOv4
+    anchor_xywh_obj,      // YOLOv5
+    none,                 // YOLOv6
+    none,                 // YOLOv7
+    channel_xywh,         // YOLOv8
+    channel_xywh,         // YOLOv9
+    none,                 // YOLOv10
+    channel_xywh,         // YOLOv11
+    channel_xywh,         // YOLOv12
+    none,                 // YOLOv13
+    anchor_xyxy_nms_free, // YOLO26
+};
+
+static_assert(sizeof(detect_table) / sizeof(DecoderEntry) == YOLO26 + 1,
+              "one detect decoder per Algo_Type");
+static_assert(sizeof(segment_table) / sizeof(DecoderEntry) == YOLO26 + 1,
+              "one segment decoder per Algo_Type");
+
+} // namespace
+
+DecoderEntry find_decoder(Algo_Type algo_type, Task_Type task_type) {
+  if (algo_type < YOLOv3 || algo_type > YOLO26)
+    return {};
+  if (task_type == Detect)
+    return detect_table[algo_type];
+  if (task_type == Segment)
+    return segment_table[algo_type];
+  return {};
+}
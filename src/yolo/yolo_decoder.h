@@ -0,0 +1,66 @@
+/*
+ * @Description: compile-time specialised decoders of YOLO outputs
+ */
+
+#pragma once
+
+#include "yolo.h"
+
+/**
+ * @description: inputs of a decoder, one frame
+ */
+struct DecodeArgs {
+  const float *output;             // output0 of the frame
+  int numbox;                      // anchors
+  int numprob;                     // values per anchor
+  int class_num;                   // class score rows
+  const std::vector<int> *classes; // sorted allow-list, empty keeps all
+  float score_threshold;
+  float confidence_threshold;      // objectness, v5 and v7
+  cv::Size image_size;             // boxes are clipped to it, as before
+  cv::Size input_size;             // scale of normalized boxes, v4
+  int coeff_count;                 // mask coefficients per anchor, 0 = none
+};
+
+/**
+ * @description: candidates that passed the score threshold, boxes in network
+ *               input coordinates. Buffers are reused between frames
+ */
+struct Candidates {
+  std::vector<cv::Rect> boxes;
+  std::vector<float> scores;
+  std::vector<int> class_ids;
+  std::vector<float> coeffs; // coeff_count floats per candidate
+
+  void clear() {
+    boxes.clear();
+    scores.clear();
+    class_ids.clear();
+    coeffs.clear();
+  }
+};
+
+/**
+ * @description: decoder of one output layout
+ */
+using Decoder = void (*)(const DecodeArgs &args, Candidates &candidates);
+
+/**
+ * @description: decoder of an algorithm and whether its output is already
+ *               suppressed (NMS-free heads)
+ */
+struct DecoderEntry {
+  Decoder decode = nullptr;
+  bool nms_free = false;
+};
+
+/**
+ * @description:                 decoder for an algorithm and task, looked up
+ *                               once in init from a table of template
+ *                               instantiations; the decode loops carry no
+ *                               per-anchor algorithm checks
+ * @param {Algo_Type} algo_type  algorithm type
+ * @param {Task_Type} task_type  Detect or Segment
+ * @return {DecoderEntry}        decode is null for unsupported pairs
+ */
+DecoderEntry find_decoder(Algo_Type algo_type, Task_Type task_type);
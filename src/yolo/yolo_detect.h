@@ -9,6 +9,10 @@
 
 #include "yolo.h"
 #include "utils.h"
+#include "nms_engine.h"
+
+#include <algorithm>
+#include <stdexcept>
 
 #ifdef OPENCV_WITH_CUDA
 	#include <opencv2/cudawarping.hpp>
@@ -26,6 +30,65 @@ struct OutputDet
 	cv::Rect box;       //bounding box
 };
 
+/**
+ * @description: mask of one detection at prototype resolution. Image pixel
+ * (x, y) samples logits bilinearly at (x * scale.x + offset.x,
+ * y * scale.y + offset.y), clamped to the region, and is inside the mask
+ * where the value exceeds cut
+ */
+struct ProtoMask
+{
+	cv::Mat logits;     	//CV_32F mask values of the detection's prototype region
+	float cut = 0.f;    	//threshold, in the same space as logits
+	cv::Point2f scale;  	//prototype cells per image pixel
+	cv::Point2f offset; 	//prototype position of image pixel 0
+};
+
+/**
+ * @description: 				mask covering the whole box, for detections without mask output:
+ * 								a single cell above the cut, every tap clamps onto it
+ * @return {ProtoMask}
+ */
+inline ProtoMask box_proto_mask()
+{
+	ProtoMask mask;
+	mask.logits = cv::Mat(1, 1, CV_32F, cv::Scalar(1));
+	mask.cut = 0.f;
+	mask.scale = cv::Point2f(0, 0);
+	mask.offset = cv::Point2f(0, 0);
+	return mask;
+}
+
+/**
+ * @description: segmentation network output related parameters, also the per-frame
+ * result of detection models, whose masks cover their boxes
+ */
+struct OutputSeg
+{
+	int id;               	//class id
+	float score;          	//score
+	cv::Rect box;         	//bounding box
+	cv::Mat mask;         	//mask, box-sized; empty unless full masks are on
+	ProtoMask proto_mask; 	//mask at prototype resolution
+};
+
+/**
+ * @description: per-frame state of a detection or segmentation inference. Keeping it out
+ * of the model object lets the pre-process, inference and post-process stages of
+ * different frames run at the same time on one model
+ */
+struct SegmentContext
+{
+	BatchInput input;                   	//input frame
+	cv::Size image_size;                	//size results are reported in
+	cv::Vec4d params;                   	//letterbox parameters
+	aligned_vector<float> tensor;       	//model input, NCHW
+	aligned_vector<uint16_t> tensor_fp16;	//model input for FP16 models
+	aligned_vector<float> output0;      	//detection output, model layout
+	aligned_vector<float> output1;      	//mask prototypes, segmentation only
+	std::vector<OutputSeg> output_seg;  	//result
+};
+
 /**
  * @description: detection class for YOLO algorithm
  */
@@ -66,6 +129,111 @@ public:
 		m_output_numdet = 1 * m_output_numprob * m_output_numbox;		
 	}
 
+	/**
+	 * @description: 						batched inference interface, runs the stages below on every frame
+	 * @param {vector<BatchInput>} inputs	input frames
+	 * @return {vector<vector<OutputSeg>>}	result per frame
+	 */
+	std::vector<std::vector<OutputSeg>> infer_batch(const std::vector<BatchInput>& inputs)
+	{
+		std::vector<SegmentContext> contexts(inputs.size());
+		std::vector<SegmentContext*> batch;
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			contexts[i].input = inputs[i];
+			pre_process_frame(contexts[i]);
+			batch.push_back(&contexts[i]);
+		}
+		process_frames(batch);
+
+		std::vector<std::vector<OutputSeg>> results;
+		for (auto& context : contexts)
+		{
+			post_process_frame(context);
+			results.push_back(std::move(context.output_seg));
+		}
+		return results;
+	}
+
+	/**
+	 * @description: 	whether process_frames runs several frames in one inference call
+	 * @return {bool}	true when the model accepts batched input
+	 */
+	virtual bool supports_batch() const { return false; }
+
+	/**
+	 * @description: 					pre-process stage: fills the input tensor of context. Safe to
+	 * 									call from several threads at once. The default leaves all work
+	 * 									to process_frames
+	 * @param {SegmentContext&} context	frame context, input set
+	 * @return {*}
+	 */
+	virtual void pre_process_frame(SegmentContext& context) const {}
+
+	/**
+	 * @description: 							inference stage: runs the model on the prepared frames.
+	 * 											The default runs the whole member-state pipeline per
+	 * 											frame and is not thread-safe: calls on one object must
+	 * 											not overlap, so a shared session needs a backend that
+	 * 											overrides it
+	 * @param {vector<SegmentContext*>} contexts	frames to run
+	 * @return {*}
+	 */
+	virtual void process_frames(std::vector<SegmentContext*>& contexts)
+	{
+		for (auto* context : contexts)
+		{
+			set_input(context->input);
+			pre_process();
+			process();
+			post_process();
+			context->output_seg.clear();
+			for (const OutputDet& det : m_output_det)
+				context->output_seg.push_back({ det.id, det.score, det.box, cv::Mat(), box_proto_mask() });
+		}
+	}
+
+	/**
+	 * @description: 					post-process stage: decodes the results of context. Safe to
+	 * 									call from several threads at once
+	 * @param {SegmentContext&} context	frame context, outputs set
+	 * @return {*}
+	 */
+	virtual void post_process_frame(SegmentContext& context) const {}
+
+	/**
+	 * @description: 					restrict post-process to an allow-list of classes
+	 * @param {vector<int>} classes		class ids to keep, empty keeps all classes. Throws
+	 * 									std::runtime_error on an id outside the model's classes
+	 * @return {*}
+	 */
+	void set_classes(const std::vector<int>& classes)
+	{
+		m_classes.clear();
+		for (int id : classes)
+		{
+			if (id < 0 || id >= m_class_num)
+				throw std::runtime_error("Invalid class id " + std::to_string(id) + ", the model has " + std::to_string(m_class_num) + " classes");
+			if (std::find(m_classes.begin(), m_classes.end(), id) == m_classes.end())
+				m_classes.push_back(id);
+		}
+		std::sort(m_classes.begin(), m_classes.end());
+	}
+
+	/**
+	 * @description: 					select the NMS implementation
+	 * @param {NMS_Type} nms_type		reference or fast
+	 * @param {int} top_k				fast NMS: candidates kept before suppression, 0 = all
+	 * @param {bool} class_aware		fast NMS: suppress only within a class
+	 * @return {*}
+	 */
+	void set_nms(NMS_Type nms_type, int top_k = 0, bool class_aware = false)
+	{
+		m_nms_type = nms_type;
+		m_nms_params.top_k = top_k;
+		m_nms_params.class_aware = class_aware;
+	}
+
 protected:
 	/**
 	 * @description: 				LetterBox image process
@@ -76,7 +244,7 @@ protected:
 	 * @param {Scalar} color		filled color
 	 * @return {*}
 	 */
-	void LetterBox(cv::Mat& input_image, cv::Mat& output_image, cv::Vec4d& params, cv::Size shape = cv::Size(640, 640), cv::Scalar color = cv::Scalar(114, 114, 114))
+	void LetterBox(const cv::Mat& input_image, cv::Mat& output_image, cv::Vec4d& params, cv::Size shape = cv::Size(640, 640), cv::Scalar color = cv::Scalar(114, 114, 114)) const
 	{
 		float r = std::min((float)shape.height / (float)input_image.rows, (float)shape.width / (float)input_image.cols);
 		float ratio[2]{ r, r };
@@ -122,12 +290,22 @@ protected:
 	 * @param {float} score_threshold		detect score threshold
 	 * @param {float} nms_threshold			IOU threshold
 	 * @param {vector<int>&} indices		output indices
+	 * @param {vector<int>*} class_ids		detect classes, used by class-aware fast NMS
 	 * @return {*}
 	 */
-	void nms(std::vector<cv::Rect>& boxes, std::vector<float>& scores, float score_threshold, float nms_threshold, std::vector<int> & indices)
+	void nms(std::vector<cv::Rect>& boxes, std::vector<float>& scores, float score_threshold, float nms_threshold, std::vector<int> & indices, const std::vector<int>* class_ids = nullptr) const
 	{
 		assert(boxes.size() == scores.size());
 
+		if (m_nms_type == NMS_Type::Fast)
+		{
+			NMSParams params = m_nms_params;
+			params.score_threshold = m_score_threshold;
+			params.iou_threshold = m_nms_threshold;
+			nms_fast(boxes, scores, class_ids ? class_ids->data() : nullptr, params, indices);
+			return;
+		}
+
 		struct BoxScore
 		{
 			cv::Rect box;
@@ -185,7 +363,7 @@ protected:
 	 * @param {Size} size						output image shape
 	 * @return {*}
 	 */
-	void scale_boxes(std::vector<cv::Rect>& boxes, cv::Size size)
+	void scale_boxes(std::vector<cv::Rect>& boxes, cv::Size size) const
 	{
 		float gain = std::min(m_input_size.width * 1.0 / size.width, m_input_size.height * 1.0 / size.height);
 		int pad_w = (m_input_size.width - size.width * gain) / 2;
@@ -226,6 +404,11 @@ protected:
 	 */	
 	int m_class_num = 80;
 
+	/**
+	 * @description: allowed class ids, sorted; empty means all classes
+	 */
+	std::vector<int> m_classes;
+
 	/**
 	 * @description: score threshold
 	 */
@@ -236,6 +419,16 @@ protected:
 	 */
 	float m_nms_threshold = 0.5;
 
+	/**
+	 * @description: NMS implementation
+	 */
+	NMS_Type m_nms_type = NMS_Type::Reference;
+
+	/**
+	 * @description: fast NMS options, thresholds are taken from the members above
+	 */
+	NMSParams m_nms_params;
+
 	/**
 	 * @description: confidence threshold
 	 */
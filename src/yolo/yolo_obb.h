@@ -8,7 +8,7 @@
 #pragma once
 
 #include "yolo_detect.h"
-#include <Eigen/Dense>
+#include <cmath>
 
 /**
  * @description: detection network output related parameters
@@ -53,7 +53,9 @@ public:
 
 protected:
 	/**
-	 * @description: 								rotated Non-Maximum Suppression
+	 * @description: 								greedy rotated Non-Maximum Suppression with ProbIoU.
+	 *												Each kept box is compared only with the lower scored
+	 *												boxes not yet suppressed, so memory stays O(N)
 	 * @param {const vector<vector<float>>&} boxes	obb rotated boxes
 	 * @param {const vector<float>&} scores			obb scores		
 	 * @param {float} score_threshold				score threshold
@@ -64,147 +66,105 @@ protected:
 	void nms_rotated(const std::vector<std::vector<float>> & rboxes, const std::vector<float> & scores, float score_threshold, float nms_threshold, std::vector<int> & indices)
 	{
 		assert(rboxes.size() == scores.size());
+		indices.clear();
+		const float eps = 1e-7f;
 		std::vector<int> sorted_idx = argsort_desc(scores);
-		std::vector<std::vector<float>> rboxes_sorted(rboxes.size());
-		for(int i=0; i<rboxes.size(); i++)	
-		{
-			rboxes_sorted[i] = rboxes[sorted_idx[i]];
-		}
-		Eigen::MatrixXf boxes = vector2Eigen(rboxes_sorted);
-		Eigen::MatrixXf ious = triu_k1(probiou(boxes, boxes, 1e-7));
-		std::vector<int> pick = find_indices_max_below_threshold(ious, nms_threshold);
-		indices.resize(pick.size());
-		for(int i=0; i<pick.size(); i++)
+		const int n = sorted_idx.size();
+
+		std::vector<Gaussian> gaussians(n);
+		for (int i = 0; i < n; i++)
 		{
-			indices[i] = sorted_idx[pick[i]];
+			gaussians[i] = to_gaussian(rboxes[sorted_idx[i]]);
 		}
-	}
 
-	/**
-	 * @description: 								arg sort by descent
-	 * @param {const std::vector<float>&} vec		input vector
-	 * @return {std::vector<int>}					sorted idx
-	 */
-	std::vector<int> argsort_desc(const std::vector<float>& scores) 
-	{
-		std::vector<int> sorted_idx(scores.size());
-		for (int i = 0; i < scores.size(); ++i)		
+		// ProbIoU >= nms_threshold needs a Bhattacharyya distance of at most bd_max. The distance
+		// is at least dx^2 / (4 * var_x) and dy^2 / (4 * var_y) of the summed covariance, which
+		// rejects far apart pairs before the logarithms. The bound only holds while eps is
+		// negligible next to the determinants, i.e. not for sub-pixel boxes.
+		float hd_max = 1.0f - nms_threshold;
+		float bd_max = -std::log(std::max(1e-12f, 1.0f - hd_max * hd_max));
+		bool prefilter = bd_max < 100.0f;
+		float reach = 4.0f * bd_max * 1.01f + 1e-3f;
+
+		std::vector<char> suppressed(n, 0);
+		for (int i = 0; i < n; i++)
 		{
-			sorted_idx[i] = i;
+			if (suppressed[i])	continue;
+			indices.push_back(sorted_idx[i]);
+			const Gaussian& g1 = gaussians[i];
+			for (int j = i + 1; j < n; j++)
+			{
+				if (suppressed[j])	continue;
+				const Gaussian& g2 = gaussians[j];
+				float dx = g1.x - g2.x, dy = g1.y - g2.y;
+				if (prefilter && g1.det + g2.det >= 1e-3f && (dx * dx > reach * (g1.a + g2.a) || dy * dy > reach * (g1.b + g2.b)))	continue;
+				if (probiou(g1, g2, eps) >= nms_threshold)	suppressed[j] = 1;
+			}
 		}
-		std::sort(sorted_idx.begin(), sorted_idx.end(), [&scores](int i, int j) {return scores[i] > scores[j]; });
-		return sorted_idx;
 	}
-	
+
 	/**
-	 * @description: 											transform vector to eigen matrix
-	 * @param {const std::vector<std::vector<float>> &} vec		input vector
-	 * @return {Eigen::MatrixXf}								output matrix
+	 * @description: 	Gaussian of a rotated box: center, covariance [a c; c b] and the clamped determinant
 	 */
-	Eigen::MatrixXf vector2Eigen(const std::vector<std::vector<float>> & vec) 
+	struct Gaussian
 	{
-		Eigen::MatrixXf mat(vec.size(), vec[0].size());
-		for (int i = 0; i < vec.size(); ++i) 
-			for (int j = 0; j < vec[0].size(); ++j) 
-				mat(i, j) = vec[i][j];
-		return mat;
-	}
+		float x, y, a, b, c, det;
+	};
 
 	/**
-	 * @description: 															get covariance matrix
-	 * @param {Eigen::MatrixXf} rboxes											rotated rboxes
-	 * @return {std::tuple<Eigen::MatrixXf, Eigen::MatrixXf, Eigen::MatrixXf>}	output tuple of matrix
+	 * @description: 							Gaussian of a rotated box, computed once per box
+	 * @param {const std::vector<float>&} rbox	rotated box, x y w h ... angle
+	 * @return {Gaussian}						its Gaussian
 	 */
-	std::tuple<Eigen::MatrixXf, Eigen::MatrixXf, Eigen::MatrixXf> get_covariance_matrix(Eigen::MatrixXf rboxes)
+	Gaussian to_gaussian(const std::vector<float>& rbox)
 	{
-		Eigen::MatrixXf xy_square = rboxes.block(0, 2, rboxes.rows(), 2).array().square() / 12.0;
-		Eigen::MatrixXf c_col = rboxes.col(rboxes.cols() - 1);
-
-		Eigen::MatrixXf gbbs(rboxes.rows(), 3);
-		gbbs << xy_square, c_col;
-
-		Eigen::MatrixXf a = gbbs.col(0);
-		Eigen::MatrixXf b = gbbs.col(1);
-		Eigen::MatrixXf c = gbbs.col(2);
-
-		Eigen::MatrixXf cos = c.array().cos();
-		Eigen::MatrixXf sin = c.array().sin();
-		Eigen::MatrixXf cos2 = cos.array().square();
-		Eigen::MatrixXf sin2 = sin.array().square();
-
-		return {a.array() * cos2.array() + b.array() * sin2.array(), a.array() * sin2.array() + b.array() * cos2.array(), (a.array() - b.array()) * cos.array() * sin.array()};
+		float w2 = rbox[2] * rbox[2] / 12.0f, h2 = rbox[3] * rbox[3] / 12.0f;
+		float cos = std::cos(rbox.back()), sin = std::sin(rbox.back());
+		Gaussian g;
+		g.x = rbox[0];
+		g.y = rbox[1];
+		g.a = w2 * cos * cos + h2 * sin * sin;
+		g.b = w2 * sin * sin + h2 * cos * cos;
+		g.c = (w2 - h2) * cos * sin;
+		g.det = std::max(g.a * g.b - g.c * g.c, 0.0f);
+		return g;
 	}
 
 	/**
-	 * @description: 					probiou
-	 * @param {Eigen::MatrixXf&} obb1	obb1
-	 * @param {Eigen::MatrixXf&} obb2	obb2
-	 * @param {float} eps				eps
-	 * @return {Eigen::MatrixXf}		output matrix
+	 * @description: 				probiou of two rotated boxes
+	 * @param {Gaussian&} g1		Gaussian of the first box
+	 * @param {Gaussian&} g2		Gaussian of the second box
+	 * @param {float} eps			eps
+	 * @return {float}				probiou
 	 */
-	Eigen::MatrixXf probiou(Eigen::MatrixXf& obb1, Eigen::MatrixXf& obb2, float eps)
+	float probiou(const Gaussian& g1, const Gaussian& g2, float eps)
 	{
-		int N = obb1.rows();
-		Eigen::MatrixXf x1 = obb1.block(0, 0, N, 1), y1 = obb1.block(0, 1, N, 1); 
-		Eigen::MatrixXf x2 = obb2.col(0).transpose(), y2 = obb2.col(1).transpose();
-
-		auto [a1, b1, c1] = get_covariance_matrix(obb1);
-		auto [a2_raw, b2_raw, c2_raw] = get_covariance_matrix(obb1);
-		Eigen::MatrixXf a2 = a2_raw.transpose(), b2 = b2_raw.transpose(), c2 = c2_raw.transpose();
-			
-		Eigen::ArrayXXf a_sum = a1.array().replicate(1, N) + a2.array().replicate(N, 1);
-		Eigen::ArrayXXf b_sum = b1.array().replicate(1, N) + b2.array().replicate(N, 1);
-		Eigen::ArrayXXf c_sum = c1.array().replicate(1, N) + c2.array().replicate(N, 1);
-		Eigen::ArrayXXf x_diff = x1.array().replicate(1, N) - x2.array().replicate(N, 1);
-		Eigen::ArrayXXf y_diff = y1.array().replicate(1, N) - y2.array().replicate(N, 1);
-		Eigen::ArrayXXf denominator = a_sum * b_sum - c_sum.square() + eps;
-		Eigen::ArrayXXf t1 = (a_sum * y_diff.square() + b_sum * x_diff.square()) / denominator * 0.25f;
-		Eigen::ArrayXXf t2 = (c_sum * (-x_diff) * y_diff) / denominator * 0.5f; 
-
-		Eigen::ArrayXXf term1 = (a1.array() * b1.array() - c1.array().square()).cwiseMax(0.0f);
-		Eigen::ArrayXXf term2 = (a2.array() * b2.array() - c2.array().square()).cwiseMax(0.0f);
-		Eigen::ArrayXXf numerator_t3 = a_sum * b_sum - c_sum.square();
-		Eigen::ArrayXXf term1_term2 = term1.replicate(1, N) * term2.replicate(N, 1);
-		Eigen::ArrayXXf denominator_t3 = 4.0f * term1_term2.sqrt() + eps;
-		Eigen::ArrayXXf log_input = numerator_t3 / denominator_t3 + eps;
-		Eigen::ArrayXXf t3 = log_input.log() * 0.5f;
-		Eigen::ArrayXXf bd = (t1.array() + t2.array() + t3).cwiseMax(eps).cwiseMin(100.0f);
-		Eigen::ArrayXXf hd = (1.0f - (-bd).exp() + eps).cwiseMax(eps).sqrt();
-
-		return (1 - hd).matrix();
+		float a = g1.a + g2.a, b = g1.b + g2.b, c = g1.c + g2.c;
+		float dx = g1.x - g2.x, dy = g1.y - g2.y;
+		float det = a * b - c * c;
+		float denominator = det + eps;
+		float t1 = (a * dy * dy + b * dx * dx) / denominator * 0.25f;
+		float t2 = (c * (-dx) * dy) / denominator * 0.5f;
+		float t3 = std::log(det / (4.0f * std::sqrt(g1.det * g2.det) + eps) + eps) * 0.5f;
+		float bd = std::min(std::max(t1 + t2 + t3, eps), 100.0f);
+		float hd = std::sqrt(std::max(1.0f - std::exp(-bd) + eps, eps));
+		return 1.0f - hd;
 	}
 
 	/**
-	 * @description: 							triu k1
-	 * @param {const Eigen::MatrixXf&} mat		input matrix
-	 * @return {Eigen::MatrixXf}				output matrix
+	 * @description: 								arg sort by descent
+	 * @param {const std::vector<float>&} vec		input vector
+	 * @return {std::vector<int>}					sorted idx
 	 */
-	Eigen::MatrixXf triu_k1(const Eigen::MatrixXf& mat) 
+	std::vector<int> argsort_desc(const std::vector<float>& scores) 
 	{
-		Eigen::MatrixXf upper = mat.triangularView<Eigen::Upper>();  
-		Eigen::MatrixXf result = upper;
-		int min_dim = std::min(mat.rows(), mat.cols());
-		for(int i = 0; i < min_dim; i++) 
+		std::vector<int> sorted_idx(scores.size());
+		for (int i = 0; i < scores.size(); ++i)		
 		{
-			result(i, i) = 0.0; 
+			sorted_idx[i] = i;
 		}
-		return result;
-	}
-
-	/**
-	 * @description: 							find indices max below threshold
-	 * @param {const Eigen::MatrixXf&} ious		ious
-	 * @param {float} threshold					threshold
-	 * @return {std::vector<int>}				indices
-	 */
-	std::vector<int> find_indices_max_below_threshold(const Eigen::MatrixXf& ious, float threshold) 
-	{	
-		std::vector<int> indices;
-		Eigen::VectorXf col_max = ious.colwise().maxCoeff();	
-		for (int i = 0; i < ious.cols(); ++i) 
-			if (col_max(i) < threshold) 
-				indices.push_back(i);	
-		return indices;
+		std::sort(sorted_idx.begin(), sorted_idx.end(), [&scores](int i, int j) {return scores[i] > scores[j]; });
+		return sorted_idx;
 	}
 
 	/**
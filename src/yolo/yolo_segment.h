@@ -9,16 +9,6 @@
 
 #include "yolo_detect.h"
 
-/**
- * @description: segmentation network output related parameters
- */
-struct OutputSeg {
-  int id;       // class id
-  float score;  // score
-  cv::Rect box; // bounding box
-  cv::Mat mask; // mask
-};
-
 /**
  * @description: mask parameters
  */
@@ -31,6 +21,7 @@ struct MaskParams {
   float mask_threshold = 0.5; // threshold of segmentation mask
   cv::Size input_shape;       // input shape of image
   cv::Vec4d params;           // parameters of letterbox
+  bool full_masks = true;     // also upsample masks into OutputSeg::mask
 };
 
 /**
@@ -38,6 +29,36 @@ struct MaskParams {
  */
 class YOLO_Segment : virtual public YOLO_Detect {
 public:
+  /**
+   * @description:                        inference stage: runs the model on
+   *                                      the prepared frames. The default runs
+   *                                      the whole member-state pipeline per
+   *                                      frame and is not thread-safe: calls
+   *                                      on one object must not overlap, so a
+   *                                      shared session needs a backend that
+   *                                      overrides it
+   * @param {vector<SegmentContext*>} contexts  frames to run
+   * @return {*}
+   */
+  virtual void process_frames(std::vector<SegmentContext *> &contexts) {
+    for (auto *context : contexts) {
+      set_input(context->input);
+      pre_process();
+      process();
+      post_process();
+      context->output_seg = m_output_seg;
+    }
+  }
+
+  /**
+   * @description:                whether post-process also upsamples every
+   *                              mask into OutputSeg::mask. Callers that only
+   *                              read OutputSeg::proto_mask turn it off
+   * @param {bool} full           full-resolution masks on or off
+   * @return {*}
+   */
+  void set_full_masks(bool full) { m_mask_params.full_masks = full; }
+
   void init(const Algo_Type algo_type, const Device_Type device_type,
             const Model_Type model_type, const std::string model_path) {
     if (m_algo_type == YOLOv5) {
@@ -74,7 +95,7 @@ protected:
    */
   void GetMask(const cv::Mat &mask_proposals, const cv::Mat &mask_protos,
                OutputSeg &output, const MaskParams &mask_params,
-               const Algo_Type algo_type) {
+               const Algo_Type algo_type) const {
     int seg_channels = mask_params.seg_channels;
     int net_width = mask_params.net_width;
     int seg_width = mask_params.seg_width;
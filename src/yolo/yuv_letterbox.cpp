@@ -0,0 +1,320 @@
+/*
+ * @Description: fused YUV 4:2:0 to letterboxed tensor pre-process
+ */
+
+#include "yuv_letterbox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define YUV_LETTERBOX_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define YUV_LETTERBOX_NEON 1
+#endif
+
+namespace {
+
+/**
+ * @description: BT.601 YUV to RGB coefficients, the swscale default matrix
+ */
+struct ColorCoeffs {
+  float y_offset;
+  float y_scale;
+  float r_v;
+  float g_u;
+  float g_v;
+  float b_u;
+};
+
+ColorCoeffs color_coeffs(bool full_range) {
+  if (full_range)
+    return {0.f, 1.f, 1.402f, 0.344136f, 0.714136f, 1.772f};
+  return {16.f, 255.f / 219.f, 1.596027f, 0.391762f, 0.812968f, 2.017232f};
+}
+
+/**
+ * @description: bilinear taps along one axis. For every output coordinate
+ * the first source index (clamped so that index + 1 is still inside the
+ * plane) and the weight of the second tap. Luma positions follow cv::resize
+ * (half-pixel centers); chroma positions are derived from them with 4:2:0
+ * siting, left-aligned horizontally (shift 0) and centered vertically
+ * (shift 0.5).
+ */
+void build_taps(int dst_len, int src_len, float chroma_shift, bool chroma,
+                std::vector<int> &index, std::vector<float> &weight) {
+  index.resize(dst_len);
+  weight.resize(dst_len);
+  const double scale = double(src_len) / dst_len;
+  const int len = chroma ? (src_len + 1) / 2 : src_len;
+  for (int o = 0; o < dst_len; ++o) {
+    double pos = (o + 0.5) * scale - 0.5;
+    if (chroma)
+      pos = (pos - chroma_shift) * 0.5;
+    if (pos <= 0) {
+      index[o] = 0;
+      weight[o] = 0.f;
+    } else if (pos >= len - 1) {
+      index[o] = len - 2;
+      weight[o] = 1.f;
+    } else {
+      index[o] = int(pos);
+      weight[o] = float(pos - index[o]);
+    }
+  }
+}
+
+/**
+ * @description: one output row of the scaled image
+ */
+struct RowArgs {
+  const uint8_t *y0, *y1; // luma rows above / below the sample position
+  const uint8_t *u0, *u1;
+  const uint8_t *v0, *v1;
+  float fy;  // luma vertical weight
+  float fcy; // chroma vertical weight
+  const int *xi;
+  const float *xf;
+  const int *ci;
+  const float *cf;
+  float *r, *g, *b;
+  ColorCoeffs k;
+};
+
+inline float bilerp(const uint8_t *r0, const uint8_t *r1, int i, float fx,
+                    float fy) {
+  float top = r0[i] + (r0[i + 1] - r0[i]) * fx;
+  float bottom = r1[i] + (r1[i + 1] - r1[i]) * fx;
+  return top + (bottom - top) * fy;
+}
+
+inline float clamp255(float v) { return std::min(std::max(v, 0.f), 255.f); }
+
+void row_scalar(const RowArgs &a, int begin, int end) {
+  const float inv = 1.f / 255.f;
+  for (int x = begin; x < end; ++x) {
+    float y = (bilerp(a.y0, a.y1, a.xi[x], a.xf[x], a.fy) - a.k.y_offset) *
+              a.k.y_scale;
+    float u = bilerp(a.u0, a.u1, a.ci[x], a.cf[x], a.fcy) - 128.f;
+    float v = bilerp(a.v0, a.v1, a.ci[x], a.cf[x], a.fcy) - 128.f;
+    a.r[x] = clamp255(y + a.k.r_v * v) * inv;
+    a.g[x] = clamp255(y - a.k.g_u * u - a.k.g_v * v) * inv;
+    a.b[x] = clamp255(y + a.k.b_u * u) * inv;
+  }
+}
+
+#ifdef YUV_LETTERBOX_AVX2
+bool cpu_has_avx2() {
+  static const bool has =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return has;
+}
+
+// One 32-bit gather at index i yields the byte pair (i, i + 1) needed by the
+// horizontal lerp, so each row costs a single gather.
+__attribute__((target("avx2,fma"))) inline __m256
+bilerp_avx2(const uint8_t *r0, const uint8_t *r1, __m256i index, __m256 fx,
+            __m256 fy) {
+  const __m256i mask = _mm256_set1_epi32(0xFF);
+  __m256i g0 =
+      _mm256_i32gather_epi32(reinterpret_cast<const int *>(r0), index, 1);
+  __m256i g1 =
+      _mm256_i32gather_epi32(reinterpret_cast<const int *>(r1), index, 1);
+  __m256 a0 = _mm256_cvtepi32_ps(_mm256_and_si256(g0, mask));
+  __m256 b0 =
+      _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(g0, 8), mask));
+  __m256 a1 = _mm256_cvtepi32_ps(_mm256_and_si256(g1, mask));
+  __m256 b1 =
+      _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(g1, 8), mask));
+  __m256 top = _mm256_fmadd_ps(_mm256_sub_ps(b0, a0), fx, a0);
+  __m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(b1, a1), fx, a1);
+  return _mm256_fmadd_ps(_mm256_sub_ps(bottom, top), fy, top);
+}
+
+// Returns the first column left for the scalar tail.
+__attribute__((target("avx2,fma"))) int row_avx2(const RowArgs &a, int end) {
+  const __m256 fy = _mm256_set1_ps(a.fy);
+  const __m256 fcy = _mm256_set1_ps(a.fcy);
+  const __m256 y_offset = _mm256_set1_ps(a.k.y_offset);
+  const __m256 y_scale = _mm256_set1_ps(a.k.y_scale);
+  const __m256 bias = _mm256_set1_ps(128.f);
+  const __m256 r_v = _mm256_set1_ps(a.k.r_v);
+  const __m256 g_u = _mm256_set1_ps(a.k.g_u);
+  const __m256 g_v = _mm256_set1_ps(a.k.g_v);
+  const __m256 b_u = _mm256_set1_ps(a.k.b_u);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 max = _mm256_set1_ps(255.f);
+  const __m256 inv = _mm256_set1_ps(1.f / 255.f);
+
+  int x = 0;
+  for (; x + 8 <= end; x += 8) {
+    __m256i xi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.xi + x));
+    __m256i ci = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.ci + x));
+    __m256 xf = _mm256_loadu_ps(a.xf + x);
+    __m256 cf = _mm256_loadu_ps(a.cf + x);
+
+    __m256 y = _mm256_mul_ps(
+        _mm256_sub_ps(bilerp_avx2(a.y0, a.y1, xi, xf, fy), y_offset), y_scale);
+    __m256 u = _mm256_sub_ps(bilerp_avx2(a.u0, a.u1, ci, cf, fcy), bias);
+    __m256 v = _mm256_sub_ps(bilerp_avx2(a.v0, a.v1, ci, cf, fcy), bias);
+
+    __m256 r = _mm256_fmadd_ps(v, r_v, y);
+    __m256 g = _mm256_fnmadd_ps(v, g_v, _mm256_fnmadd_ps(u, g_u, y));
+    __m256 b = _mm256_fmadd_ps(u, b_u, y);
+
+    r = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(r, zero), max), inv);
+    g = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(g, zero), max), inv);
+    b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(b, zero), max), inv);
+    _mm256_storeu_ps(a.r + x, r);
+    _mm256_storeu_ps(a.g + x, g);
+    _mm256_storeu_ps(a.b + x, b);
+  }
+  return x;
+}
+#endif // YUV_LETTERBOX_AVX2
+
+#ifdef YUV_LETTERBOX_NEON
+// NEON has no gather: taps are sampled scalar, the color math is vectorized.
+int row_neon(const RowArgs &a, int end) {
+  const float32x4_t y_offset = vdupq_n_f32(a.k.y_offset);
+  const float32x4_t bias = vdupq_n_f32(128.f);
+  const float32x4_t zero = vdupq_n_f32(0.f);
+  const float32x4_t max = vdupq_n_f32(255.f);
+  const float32x4_t inv = vdupq_n_f32(1.f / 255.f);
+
+  int x = 0;
+  for (; x + 4 <= end; x += 4) {
+    float ys[4], us[4], vs[4];
+    for (int i = 0; i < 4; ++i) {
+      ys[i] = bilerp(a.y0, a.y1, a.xi[x + i], a.xf[x + i], a.fy);
+      us[i] = bilerp(a.u0, a.u1, a.ci[x + i], a.cf[x + i], a.fcy);
+      vs[i] = bilerp(a.v0, a.v1, a.ci[x + i], a.cf[x + i], a.fcy);
+    }
+    float32x4_t y = vmulq_n_f32(vsubq_f32(vld1q_f32(ys), y_offset), a.k.y_scale);
+    float32x4_t u = vsubq_f32(vld1q_f32(us), bias);
+    float32x4_t v = vsubq_f32(vld1q_f32(vs), bias);
+
+    float32x4_t r = vmlaq_n_f32(y, v, a.k.r_v);
+    float32x4_t g = vmlsq_n_f32(vmlsq_n_f32(y, u, a.k.g_u), v, a.k.g_v);
+    float32x4_t b = vmlaq_n_f32(y, u, a.k.b_u);
+
+    vst1q_f32(a.r + x, vmulq_f32(vminq_f32(vmaxq_f32(r, zero), max), inv));
+    vst1q_f32(a.g + x, vmulq_f32(vminq_f32(vmaxq_f32(g, zero), max), inv));
+    vst1q_f32(a.b + x, vmulq_f32(vminq_f32(vmaxq_f32(b, zero), max), inv));
+  }
+  return x;
+}
+#endif // YUV_LETTERBOX_NEON
+
+} // namespace
+
+LetterBoxInfo letterbox_info(const cv::Size &src, const cv::Size &dst) {
+  LetterBoxInfo info;
+  info.ratio = std::min((float)dst.height / (float)src.height,
+                        (float)dst.width / (float)src.width);
+  info.width = (int)std::round((float)src.width * info.ratio);
+  info.height = (int)std::round((float)src.height * info.ratio);
+
+  float dw = (float)(dst.width - info.width) / 2;
+  float dh = (float)(dst.height - info.height) / 2;
+  info.left = int(std::round(dw - 0.1f));
+  info.top = int(std::round(dh - 0.1f));
+  return info;
+}
+
+LetterBoxInfo yuv420_to_letterbox_tensor(const YUVImage &image,
+                                         const cv::Size &shape, float *tensor,
+                                         const cv::Scalar &color) {
+  LetterBoxInfo info =
+      letterbox_info(cv::Size(image.width, image.height), shape);
+
+  const int plane = shape.width * shape.height;
+  float *out[3] = {tensor, tensor + plane, tensor + 2 * plane};
+
+  // Padding: the tensor is RGB, the color is BGR like cv::copyMakeBorder.
+  const float pad[3] = {float(color[2] / 255.0), float(color[1] / 255.0),
+                        float(color[0] / 255.0)};
+  for (int c = 0; c < 3; ++c) {
+    float *p = out[c];
+    std::fill(p, p + info.top * shape.width, pad[c]);
+    std::fill(p + (info.top + info.height) * shape.width, p + plane, pad[c]);
+    for (int y = info.top; y < info.top + info.height; ++y) {
+      float *row = p + y * shape.width;
+      std::fill(row, row + info.left, pad[c]);
+      std::fill(row + info.left + info.width, row + shape.width, pad[c]);
+    }
+  }
+
+  thread_local std::vector<int> xi, ci, yi, cyi;
+  thread_local std::vector<float> xf, cf, yf, cyf;
+  build_taps(info.width, image.width, 0.f, false, xi, xf);
+  build_taps(info.width, image.width, 0.f, true, ci, cf);
+  build_taps(info.height, image.height, 0.f, false, yi, yf);
+  build_taps(info.height, image.height, 0.5f, true, cyi, cyf);
+
+  // The AVX2 gather reads 4 bytes at each tap; only columns whose reads stay
+  // inside the row stride take the vector path.
+  const int chroma_stride = std::min(image.linesize[1], image.linesize[2]);
+  int vector_end = 0;
+  while (vector_end < info.width && xi[vector_end] + 4 <= image.linesize[0] &&
+         ci[vector_end] + 4 <= chroma_stride)
+    ++vector_end;
+
+  RowArgs a;
+  a.xi = xi.data();
+  a.xf = xf.data();
+  a.ci = ci.data();
+  a.cf = cf.data();
+  a.k = color_coeffs(image.full_range);
+
+  for (int oy = 0; oy < info.height; ++oy) {
+    a.y0 = image.data[0] + (size_t)yi[oy] * image.linesize[0];
+    a.y1 = a.y0 + image.linesize[0];
+    a.u0 = image.data[1] + (size_t)cyi[oy] * image.linesize[1];
+    a.u1 = a.u0 + image.linesize[1];
+    a.v0 = image.data[2] + (size_t)cyi[oy] * image.linesize[2];
+    a.v1 = a.v0 + image.linesize[2];
+    a.fy = yf[oy];
+    a.fcy = cyf[oy];
+
+    size_t offset = (size_t)(info.top + oy) * shape.width + info.left;
+    a.r = out[0] + offset;
+    a.g = out[1] + offset;
+    a.b = out[2] + offset;
+
+    int x = 0;
+#if defined(YUV_LETTERBOX_AVX2)
+    if (cpu_has_avx2())
+      x = row_avx2(a, vector_end);
+#elif defined(YUV_LETTERBOX_NEON)
+    x = row_neon(a, info.width);
+#endif
+    row_scalar(a, x, info.width);
+  }
+  return info;
+}
+
+cv::Mat yuv420_to_bgr(const YUVImage &image) {
+  // cv::cvtColor wants one contiguous I420 buffer with even dimensions.
+  int width = image.width & ~1;
+  int height = image.height & ~1;
+  cv::Mat i420(height * 3 / 2, width, CV_8UC1);
+  for (int y = 0; y < height; ++y)
+    std::memcpy(i420.ptr(y), image.data[0] + (size_t)y * image.linesize[0],
+                width);
+  uint8_t *dst = i420.ptr(height);
+  for (int c = 1; c < 3; ++c) {
+    for (int y = 0; y < height / 2; ++y) {
+      std::memcpy(dst, image.data[c] + (size_t)y * image.linesize[c],
+                  width / 2);
+      dst += width / 2;
+    }
+  }
+  cv::Mat bgr;
+  cv::cvtColor(i420, bgr, cv::COLOR_YUV2BGR_I420);
+  return bgr;
+}
@@ -0,0 +1,48 @@
+/*
+ * @Description: fused YUV 4:2:0 to letterboxed tensor pre-process
+ */
+
+#pragma once
+
+#include "yolo.h"
+
+/**
+ * @description: letterbox geometry, identical to YOLO_Detect::LetterBox
+ */
+struct LetterBoxInfo {
+  float ratio = 1.f; // scale from source image to model input
+  int width = 0;     // scaled image width inside the letterbox
+  int height = 0;    // scaled image height inside the letterbox
+  int left = 0;      // padding left of the scaled image
+  int top = 0;       // padding above the scaled image
+};
+
+/**
+ * @description:             compute letterbox geometry
+ * @param {Size&} src        source image size
+ * @param {Size&} dst        model input size
+ * @return {LetterBoxInfo}   letterbox geometry
+ */
+LetterBoxInfo letterbox_info(const cv::Size &src, const cv::Size &dst);
+
+/**
+ * @description:             resize, letterbox, convert to RGB and normalize
+ *                           YUV 4:2:0 planes into a planar (NCHW) float tensor
+ *                           in one pass. Uses AVX2 or NEON when available.
+ * @param {YUVImage&} image  input planes (at least 4x4)
+ * @param {Size&} shape      model input size
+ * @param {float*} tensor    output, 3 * shape.area() floats, RGB order
+ * @param {Scalar} color     padding color (BGR, 0-255)
+ * @return {LetterBoxInfo}   letterbox geometry used
+ */
+LetterBoxInfo yuv420_to_letterbox_tensor(
+    const YUVImage &image, const cv::Size &shape, float *tensor,
+    const cv::Scalar &color = cv::Scalar(114, 114, 114));
+
+/**
+ * @description:             convert YUV 4:2:0 planes to a BGR image, for
+ *                           models without a fused YUV pre-process
+ * @param {YUVImage&} image  input planes
+ * @return {Mat}             BGR image
+ */
+cv::Mat yuv420_to_bgr(const YUVImage &image);
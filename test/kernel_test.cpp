@@ -0,0 +1,593 @@
+// Kernel tests: every SIMD kernel against its scalar or reference version on
+// random inputs, with lengths that leave tails shorter than a vector and with
+// tied values. Exits non-zero if any kernel disagrees.
+//
+//   kernel_test [seed]
+
+#include "channel_major.h"
+#include "nms_engine.h"
+#include "RedactKernel.h"
+#include "utils.h"
+#include "yolo_detect.h"
+#include "yuv_letterbox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KERNEL_TEST_X86 1
+#endif
+
+static std::mt19937 rng;
+static int failures = 0;
+
+static bool check(bool ok, const std::string &what) {
+  if (!ok && failures++ < 20)
+    std::cerr << "  mismatch: " << what << std::endl;
+  return ok;
+}
+
+// YOLO_Detect with the reference NMS and LetterBox reachable.
+class Probe : public YOLO_Detect {
+public:
+  void reference_nms(std::vector<cv::Rect> boxes, std::vector<float> scores,
+                     float score_threshold, float iou_threshold,
+                     std::vector<int> &indices) {
+    m_score_threshold = score_threshold;
+    m_nms_threshold = iou_threshold;
+    nms(boxes, scores, m_score_threshold, m_nms_threshold, indices);
+  }
+  cv::Vec4d letterbox(const cv::Size &image, const cv::Size &shape) {
+    cv::Mat input(image, CV_8UC3, cv::Scalar(0, 0, 0)), output;
+    cv::Vec4d params;
+    LetterBox(input, output, params, shape);
+    return params;
+  }
+
+protected:
+  void pre_process() override {}
+  void process() override {}
+  void post_process() override {}
+};
+
+// ---------------------------------------------------------------- letterbox
+
+// Bilinear sample of a plane at a source position, clamped to the edges.
+static double sample(const uint8_t *plane, int stride, int width, int height,
+                     double x, double y) {
+  x = std::min(std::max(x, 0.0), double(width - 1));
+  y = std::min(std::max(y, 0.0), double(height - 1));
+  int x0 = int(x), y0 = int(y);
+  int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+  double fx = x - x0, fy = y - y0;
+  auto at = [&](int xx, int yy) { return double(plane[yy * stride + xx]); };
+  double top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+  double bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+  return top + (bottom - top) * fy;
+}
+
+// What the fused kernel promises: LetterBox geometry, cv::resize bilinear
+// luma positions, 4:2:0 chroma siting (left horizontally, centered
+// vertically) and BT.601 colors, computed per pixel in double precision.
+static std::vector<float> reference_letterbox(const YUVImage &image,
+                                              const cv::Size &shape,
+                                              const LetterBoxInfo &info) {
+  const int plane = shape.area();
+  std::vector<float> tensor(3 * plane, 114.0f / 255.0f);
+  const int cw = (image.width + 1) / 2, ch = (image.height + 1) / 2;
+  const double sx = double(image.width) / info.width;
+  const double sy = double(image.height) / info.height;
+  double offset = 16, scale = 255.0 / 219.0;
+  double r_v = 1.596027, g_u = 0.391762, g_v = 0.812968, b_u = 2.017232;
+  if (image.full_range) {
+    offset = 0, scale = 1;
+    r_v = 1.402, g_u = 0.344136, g_v = 0.714136, b_u = 1.772;
+  }
+  auto clamp = [](double v) { return std::min(std::max(v, 0.0), 255.0); };
+
+  for (int oy = 0; oy < info.height; ++oy) {
+    double ly = (oy + 0.5) * sy - 0.5;
+    double cy = (ly - 0.5) * 0.5;
+    for (int ox = 0; ox < info.width; ++ox) {
+      double lx = (ox + 0.5) * sx - 0.5;
+      double cx = lx * 0.5;
+      double y = (sample(image.data[0], image.linesize[0], image.width,
+                         image.height, lx, ly) -
+                  offset) *
+                 scale;
+      double u = sample(image.data[1], image.linesize[1], cw, ch, cx, cy) - 128;
+      double v = sample(image.data[2], image.linesize[2], cw, ch, cx, cy) - 128;
+      size_t at = size_t(info.top + oy) * shape.width + info.left + ox;
+      tensor[at] = float(clamp(y + r_v * v) / 255);
+      tensor[plane + at] = float(clamp(y - g_u * u - g_v * v) / 255);
+      tensor[2 * plane + at] = float(clamp(y + b_u * u) / 255);
+    }
+  }
+  return tensor;
+}
+
+static void test_letterbox() {
+  const cv::Size images[] = {{4, 4},     {5, 7},     {17, 9},   {33, 20},
+                             {101, 37},  {640, 360}, {641, 479}, {1280, 720}};
+  const cv::Size shapes[] = {{640, 640}, {64, 48}, {31, 17}, {320, 192}};
+  for (const cv::Size &size : images) {
+    for (const cv::Size &shape : shapes) {
+      for (int padding : {0, 13}) {
+        for (bool full_range : {false, true}) {
+          // Without row padding the gather bound leaves the last columns to
+          // the scalar tail; with it more columns take the vector path.
+          const int cw = (size.width + 1) / 2, ch = (size.height + 1) / 2;
+          std::vector<uint8_t> planes[3] = {
+              std::vector<uint8_t>(size_t(size.width + padding) * size.height),
+              std::vector<uint8_t>(size_t(cw + padding) * ch),
+              std::vector<uint8_t>(size_t(cw + padding) * ch)};
+          YUVImage image;
+          for (int c = 0; c < 3; ++c) {
+            for (uint8_t &b : planes[c])
+              b = uint8_t(rng());
+            image.data[c] = planes[c].data();
+            image.linesize[c] = (c ? cw : size.width) + padding;
+          }
+          image.width = size.width;
+          image.height = size.height;
+          image.full_range = full_range;
+
+          std::string what = "letterbox " + std::to_string(size.width) + "x" +
+                             std::to_string(size.height) + " -> " +
+                             std::to_string(shape.width) + "x" +
+                             std::to_string(shape.height) +
+                             " padding=" + std::to_string(padding) +
+                             " full_range=" + std::to_string(full_range);
+
+          std::vector<float> tensor(3 * shape.area());
+          LetterBoxInfo info =
+              yuv420_to_letterbox_tensor(image, shape, tensor.data());
+          cv::Vec4d params = Probe().letterbox(size, shape);
+          check(float(params[0]) == info.ratio && params[2] == info.left &&
+                    params[3] == info.top,
+                what + " geometry vs LetterBox");
+
+          std::vector<float> reference = reference_letterbox(image, shape, info);
+          float worst = 0;
+          for (size_t i = 0; i < tensor.size(); ++i)
+            worst = std::max(worst, std::abs(tensor[i] - reference[i]));
+          check(worst <= 1e-4f, what + " max error " + std::to_string(worst));
+        }
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------- argmax
+
+static void test_column_argmax() {
+  for (int rows : {1, 2, 3, 5, 80}) {
+    for (int cols = 1; cols <= 70; cols += (cols < 20 ? 1 : 7)) {
+      for (bool ties : {false, true}) {
+        std::vector<float> data(size_t(rows) * cols);
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        for (float &v : data)
+          v = ties ? float(rng() % 4) * 0.25f : value(rng);
+
+        // All rows, then a random subset in a shuffled order, which is also
+        // the order ties prefer.
+        std::vector<int> all(rows), subset;
+        std::iota(all.begin(), all.end(), 0);
+        for (int r = 0; r < rows; ++r) {
+          if (rng() % 2 || subset.empty())
+            subset.push_back(r);
+        }
+        std::shuffle(subset.begin(), subset.end(), rng);
+
+        for (const std::vector<int> *list : {&all, &subset}) {
+          std::vector<float> max(cols);
+          std::vector<int> argmax(cols);
+          if (list == &all)
+            column_argmax(data.data(), rows, cols, max.data(), argmax.data());
+          else
+            column_argmax(data.data(), list->data(), int(list->size()), cols,
+                          max.data(), argmax.data());
+
+          for (int x = 0; x < cols; ++x) {
+            int best = (*list)[0];
+            for (int r : *list) {
+              if (data[size_t(r) * cols + x] > data[size_t(best) * cols + x])
+                best = r;
+            }
+            check(argmax[x] == best &&
+                      max[x] == data[size_t(best) * cols + x],
+                  "column_argmax rows=" + std::to_string(rows) +
+                      " cols=" + std::to_string(cols) +
+                      " ties=" + std::to_string(ties) +
+                      " subset=" + std::to_string(list == &subset) +
+                      " x=" + std::to_string(x));
+          }
+        }
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------- redaction
+
+// One plane as redactYuv420 documents it: every pixel of box whose bilinear
+// mask sample (clamped to the prototype) is above the cut becomes fill.
+// Samples within eps of the cut may go either way with FMA rounding.
+static void check_redacted_plane(const std::vector<uint8_t> &before,
+                                 const std::vector<uint8_t> &after, int stride,
+                                 int width, int height, cv::Rect box,
+                                 const ProtoMask &mask, double scale_x,
+                                 double scale_y, double offset_x,
+                                 double offset_y, uint8_t fill,
+                                 const std::string &what) {
+  const cv::Mat &logits = mask.logits;
+  auto cell = [&](int x, int y) { return double(logits.ptr<float>(y)[x]); };
+  int wrong = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      size_t at = size_t(y) * stride + x;
+      bool inside = x >= box.x && x < box.x + box.width && y >= box.y &&
+                    y < box.y + box.height;
+      if (!inside) {
+        wrong += after[at] != before[at];
+        continue;
+      }
+      double px = std::min(std::max(x * scale_x + offset_x, 0.0),
+                           double(logits.cols - 1));
+      double py = std::min(std::max(y * scale_y + offset_y, 0.0),
+                           double(logits.rows - 1));
+      int x0 = int(px), y0 = int(py);
+      int x1 = std::min(x0 + 1, logits.cols - 1);
+      int y1 = std::min(y0 + 1, logits.rows - 1);
+      double top = cell(x0, y0) + (cell(x1, y0) - cell(x0, y0)) * (px - x0);
+      double bottom = cell(x0, y1) + (cell(x1, y1) - cell(x0, y1)) * (px - x0);
+      double value = top + (bottom - top) * (py - y0);
+      if (std::abs(value - mask.cut) < 1e-3)
+        continue;
+      wrong += after[at] != (value > mask.cut ? fill : before[at]);
+    }
+  }
+  check(wrong == 0, what + ": " + std::to_string(wrong) + " pixels");
+}
+
+static void test_redact() {
+  const cv::Size frames[] = {{16, 16}, {37, 23}, {64, 48}, {101, 77}};
+  const int widths[] = {1, 7, 8, 9, 31, 32, 33, 40, 65, 120};
+  std::uniform_real_distribution<float> logit(-1.0f, 1.0f);
+  for (const cv::Size &size : frames) {
+    for (int padding : {0, 9}) {
+      for (int width : widths) {
+        const int cw = (size.width + 1) / 2, ch = (size.height + 1) / 2;
+        std::vector<uint8_t> planes[3] = {
+            std::vector<uint8_t>(size_t(size.width + padding) * size.height),
+            std::vector<uint8_t>(size_t(cw + padding) * ch),
+            std::vector<uint8_t>(size_t(cw + padding) * ch)};
+        YuvPlanes frame;
+        for (int c = 0; c < 3; ++c) {
+          for (uint8_t &b : planes[c])
+            b = uint8_t(rng());
+          frame.data[c] = planes[c].data();
+          frame.linesize[c] = (c ? cw : size.width) + padding;
+        }
+        frame.width = size.width;
+        frame.height = size.height;
+        frame.full_range = rng() % 2;
+
+        // Boxes may reach past the frame; the kernel clips them.
+        cv::Rect box(int(rng() % size.width) - 3, int(rng() % size.height) - 3,
+                     width, 1 + int(rng() % size.height));
+        ProtoMask mask;
+        mask.logits = cv::Mat(1 + rng() % 12, 1 + rng() % 12, CV_32F);
+        for (int y = 0; y < mask.logits.rows; ++y) {
+          for (int x = 0; x < mask.logits.cols; ++x)
+            mask.logits.ptr<float>(y)[x] = logit(rng);
+        }
+        mask.cut = (rng() % 2) * 0.25f;
+        mask.scale = cv::Point2f(float(mask.logits.cols) / width,
+                                 float(mask.logits.rows) / box.height);
+        mask.offset = cv::Point2f(-box.x * mask.scale.x - 0.5f,
+                                  -box.y * mask.scale.y - 0.5f);
+
+        std::vector<uint8_t> before[3] = {planes[0], planes[1], planes[2]};
+        redactYuv420(frame, box, mask, RedactMode::Fill, 8);
+
+        std::string what = "redactYuv420 " + std::to_string(size.width) +
+                           "x" + std::to_string(size.height) +
+                           " padding=" + std::to_string(padding) +
+                           " box width=" + std::to_string(width) +
+                           (frame.full_range ? " full range" : "");
+        cv::Rect luma = box;
+        luma &= cv::Rect(0, 0, size.width, size.height);
+        check_redacted_plane(before[0], planes[0], frame.linesize[0],
+                             size.width, size.height, luma, mask,
+                             mask.scale.x, mask.scale.y, mask.offset.x,
+                             mask.offset.y, frame.full_range ? 0 : 16,
+                             what + " Y");
+
+        // Chroma sample (cx, cy) takes the mask at the center of its 2x2
+        // luma block.
+        cv::Rect chroma(box.x / 2, box.y / 2,
+                        (box.x + box.width + 1) / 2 - box.x / 2,
+                        (box.y + box.height + 1) / 2 - box.y / 2);
+        chroma &= cv::Rect(0, 0, cw, ch);
+        for (int c = 1; c < 3; ++c)
+          check_redacted_plane(
+              before[c], planes[c], frame.linesize[c], cw, ch, chroma, mask,
+              2.0 * mask.scale.x, 2.0 * mask.scale.y,
+              mask.offset.x + 0.5 * mask.scale.x,
+              mask.offset.y + 0.5 * mask.scale.y, 128,
+              what + (c == 1 ? " U" : " V"));
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------- FP16
+
+#ifdef KERNEL_TEST_X86
+__attribute__((target("f16c"))) static uint16_t hw_to_half(float value) {
+  return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+}
+
+__attribute__((target("f16c"))) static float hw_to_float(uint16_t value) {
+  return _cvtsh_ss(value);
+}
+#endif
+
+static uint32_t bits(float value) {
+  uint32_t u;
+  std::memcpy(&u, &value, sizeof(u));
+  return u;
+}
+
+static float from_bits(uint32_t u) {
+  float value;
+  std::memcpy(&value, &u, sizeof(value));
+  return value;
+}
+
+static void test_fp16() {
+#ifdef KERNEL_TEST_X86
+  const bool f16c = __builtin_cpu_supports("f16c");
+#endif
+
+  // float16 -> float32: every half, in one call and in short calls at odd
+  // offsets so that each vector width leaves a tail.
+  std::vector<uint16_t> halves(65536);
+  std::iota(halves.begin(), halves.end(), 0);
+  std::vector<float> floats(halves.size());
+  float16_to_float32(halves.data(), floats.data(), halves.size());
+  for (size_t i = 0; i < halves.size(); ++i) {
+    float scalar = float16_to_float32(halves[i]);
+    check(bits(floats[i]) == bits(scalar), "float16_to_float32 " +
+                                               std::to_string(halves[i]));
+#ifdef KERNEL_TEST_X86
+    if (f16c)
+      check(bits(scalar) == bits(hw_to_float(halves[i])),
+            "float16_to_float32 vs vcvtph2ps " + std::to_string(halves[i]));
+#endif
+  }
+  for (size_t count = 1; count <= 40; ++count) {
+    size_t begin = (count * 977) % (halves.size() - count);
+    std::vector<float> out(count);
+    float16_to_float32(halves.data() + begin, out.data(), count);
+    for (size_t i = 0; i < count; ++i)
+      check(bits(out[i]) == bits(float16_to_float32(halves[begin + i])),
+            "float16_to_float32 tail count=" + std::to_string(count));
+  }
+
+  // float32 -> float16: every half, its neighbours one float ulp away, the
+  // midpoints to the next half (ties to even), specials and random bits.
+  std::vector<float> inputs;
+  for (uint16_t h = 0; h < 0x7C00; ++h) {
+    float value = float16_to_float32(h);
+    float next = float16_to_float32(uint16_t(h + 1));
+    float mid = float((double(value) + double(next)) / 2);
+    for (float v : {value, mid, std::nextafter(value, 0.0f),
+                    std::nextafter(value, INFINITY), std::nextafter(mid, 0.0f),
+                    std::nextafter(mid, INFINITY)}) {
+      inputs.push_back(v);
+      inputs.push_back(-v);
+    }
+  }
+  for (uint32_t u : {0x7F800000u, 0xFF800000u, 0x7FC00000u, 0x7F800001u,
+                     0x7FBFFFFFu, 0xFFC12345u, 0x477FEFFFu, 0x477FF000u,
+                     0x33000000u, 0x33000001u, 0x00000001u, 0x80000001u})
+    inputs.push_back(from_bits(u));
+  for (int i = 0; i < 1000000; ++i)
+    inputs.push_back(from_bits(uint32_t(rng())));
+
+  std::vector<uint16_t> out(inputs.size());
+  float32_to_float16(inputs.data(), out.data(), inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    uint16_t scalar = float32_to_float16(inputs[i]);
+    std::string what = "float32_to_float16 bits=" + std::to_string(bits(inputs[i]));
+    check(out[i] == scalar, what);
+#ifdef KERNEL_TEST_X86
+    if (f16c)
+      check(scalar == hw_to_half(inputs[i]), what + " vs vcvtps2ph");
+#endif
+  }
+  for (size_t count = 1; count <= 40; ++count) {
+    size_t begin = (count * 7919) % (inputs.size() - count);
+    std::vector<uint16_t> tail(count);
+    float32_to_float16(inputs.data() + begin, tail.data(), count);
+    for (size_t i = 0; i < count; ++i)
+      check(tail[i] == float32_to_float16(inputs[begin + i]),
+            "float32_to_float16 tail count=" + std::to_string(count));
+  }
+}
+
+// ---------------------------------------------------------------- NMS
+
+// The reference loop of YOLO_Detect::nms with a stable sort, i.e. the tie
+// rule nms_fast documents, plus the top_k cap and per-class suppression.
+static std::vector<int> stable_nms(const std::vector<cv::Rect> &boxes,
+                                   const std::vector<float> &scores,
+                                   const int *class_ids,
+                                   const NMSParams &params) {
+  std::vector<int> order;
+  for (int i = 0; i < int(scores.size()); ++i) {
+    if (scores[i] > params.score_threshold)
+      order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return scores[a] > scores[b]; });
+  if (params.top_k > 0 && int(order.size()) > params.top_k)
+    order.resize(params.top_k);
+
+  std::vector<bool> suppressed(order.size(), false);
+  std::vector<int> indices;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (suppressed[i])
+      continue;
+    indices.push_back(order[i]);
+    const cv::Rect &a = boxes[order[i]];
+    for (size_t j = i + 1; j < order.size(); ++j) {
+      const cv::Rect &b = boxes[order[j]];
+      if (suppressed[j] || (params.class_aware &&
+                            class_ids[order[i]] != class_ids[order[j]]))
+        continue;
+      float x1 = std::max(a.x, b.x), y1 = std::max(a.y, b.y);
+      float x2 = std::min(a.x + a.width, b.x + b.width);
+      float y2 = std::min(a.y + a.height, b.y + b.height);
+      float inter = std::max(0.0f, x2 - x1) * std::max(0.0f, y2 - y1);
+      float area_a = a.width * a.height, area_b = b.width * b.height;
+      if (inter / (area_a + area_b - inter) >= params.iou_threshold)
+        suppressed[j] = true;
+    }
+  }
+  return indices;
+}
+
+// n boxes with sides up to max_side in an extent x extent image, a third of
+// them jittered copies of earlier boxes so that suppression actually happens.
+static std::vector<cv::Rect> random_boxes(int n, int extent, int max_side) {
+  std::uniform_int_distribution<int> pos(0, extent - 1);
+  std::uniform_int_distribution<int> side(1, max_side);
+  std::uniform_int_distribution<int> jitter(-3, 3);
+  std::vector<cv::Rect> boxes;
+  for (int i = 0; i < n; ++i) {
+    if (i > 0 && rng() % 3 == 0) {
+      cv::Rect b = boxes[rng() % i];
+      b.x = std::max(0, b.x + jitter(rng));
+      b.y = std::max(0, b.y + jitter(rng));
+      b.width = std::max(1, b.width + jitter(rng));
+      b.height = std::max(1, b.height + jitter(rng));
+      boxes.push_back(b);
+    } else {
+      boxes.emplace_back(pos(rng), pos(rng), side(rng), side(rng));
+    }
+  }
+  return boxes;
+}
+
+// Distinct scores, so the unstable sort of YOLO_Detect::nms is well defined,
+// or scores drawn from a few levels to exercise the tie rule.
+static std::vector<float> random_scores(int n, bool ties) {
+  std::vector<float> scores(n);
+  if (ties) {
+    const float levels[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
+    for (float &s : scores)
+      s = levels[rng() % 5];
+  } else {
+    std::vector<int> rank(n);
+    std::iota(rank.begin(), rank.end(), 0);
+    std::shuffle(rank.begin(), rank.end(), rng);
+    for (int i = 0; i < n; ++i)
+      scores[i] = float(rank[i] + 1) / float(n + 1);
+  }
+  return scores;
+}
+
+static void test_nms() {
+  const int sizes[] = {1,  2,  3,  7,  8,  9,  15, 16,  17,  23,  24,
+                       25, 31, 33, 63, 64, 65, 79, 100, 257, 1000, 4000};
+  for (int n : sizes) {
+    for (int layout = 0; layout < 2; ++layout) {
+      // Small boxes spread over about 2n cells make the grid path eligible
+      // (n >= 64); large boxes in a small image leave a single cell.
+      int max_side = layout ? 40 : 160;
+      int extent = layout ? std::max(3, int(std::sqrt(2.0 * n))) * max_side
+                          : 200;
+      for (bool ties : {false, true}) {
+        std::vector<cv::Rect> boxes = random_boxes(n, extent, max_side);
+        std::vector<float> scores = random_scores(n, ties);
+        std::vector<int> class_ids(n);
+        for (int &c : class_ids)
+          c = rng() % 3;
+
+        for (float iou : {0.3f, 0.5f, 0.9f}) {
+          std::vector<int> reference;
+          Probe().reference_nms(boxes, scores, 0.2f, iou, reference);
+
+          for (bool grid : {false, true}) {
+            for (bool class_aware : {false, true}) {
+              for (int top_k : {0, n / 2}) {
+                NMSParams params;
+                params.score_threshold = 0.2f;
+                params.iou_threshold = iou;
+                params.grid = grid;
+                params.class_aware = class_aware;
+                params.top_k = top_k;
+                std::vector<int> fast;
+                nms_fast(boxes, scores, class_ids.data(), params, fast);
+
+                std::string what = "nms n=" + std::to_string(n) +
+                                   " extent=" + std::to_string(extent) +
+                                   " ties=" + std::to_string(ties) +
+                                   " iou=" + std::to_string(iou) +
+                                   " grid=" + std::to_string(grid) +
+                                   " class_aware=" +
+                                   std::to_string(class_aware) +
+                                   " top_k=" + std::to_string(top_k);
+                check(fast == stable_nms(boxes, scores, class_ids.data(),
+                                         params),
+                      what);
+                if (!ties && !class_aware && top_k == 0)
+                  check(fast == reference, what + " vs YOLO_Detect::nms");
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  rng.seed(argc > 1 ? std::stoul(argv[1]) : 1);
+
+#ifdef KERNEL_TEST_X86
+  std::cout << "cpu: avx2=" << bool(__builtin_cpu_supports("avx2"))
+            << " avx512f=" << bool(__builtin_cpu_supports("avx512f"))
+            << " f16c=" << bool(__builtin_cpu_supports("f16c")) << "\n";
+#endif
+
+  struct {
+    const char *name;
+    void (*run)();
+  } tests[] = {{"yuv420_to_letterbox_tensor", test_letterbox},
+               {"column_argmax", test_column_argmax},
+               {"redactYuv420", test_redact},
+               {"fp16", test_fp16},
+               {"nms_fast", test_nms}};
+  int failed = 0;
+  for (const auto &test : tests) {
+    int before = failures;
+    test.run();
+    bool ok = failures == before;
+    failed += !ok;
+    std::cout << test.name << ": "
+              << (ok ? "ok" : std::to_string(failures - before) + " mismatches")
+              << std::endl;
+  }
+  return failed ? 1 : 0;
+}